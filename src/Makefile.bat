@@ -4,23 +4,48 @@ del *.exe
 
 del ..\run\smc.exe
 
-g++ -c carrier_class.cpp
-g++ -c device_properties.cpp
-g++ -c dev_prop_func.cpp
-g++ -c drift_velocity.cpp
-g++ -c functions.cpp
-g++ -c histogram_class.cpp
-g++ -c ii_coef.cpp
-g++ -c main.cpp
-g++ -c SMC_class.cpp
-g++ -c tools_class.cpp
-g++ -c device_class.cpp
+rem -O3 lets g++ vectorise the random number generator in rng_class.cpp
+rem -fopenmp runs the trials and the field solutions of the biases in parallel
+set CFLAGS=-O3 -fopenmp
+
+rem table_gen.exe calculates the scattering tables of the built-in materials into builtin_tables.cpp
+g++ %CFLAGS% -DNO_BUILTIN_TABLES -o table_gen.exe table_gen.cpp tools_class.cpp SMC_class.cpp cache_func.cpp functions.cpp
+table_gen.exe
+del *.o
+
+rem rng_test.exe checks the exponential random numbers of rng_class.cpp against the exponential distribution
+g++ %CFLAGS% -o rng_test.exe rng_test.cpp rng_class.cpp
+rng_test.exe
+if errorlevel 1 (
+	echo "rng_test failed, smc not built"
+	exit /b 1
+)
+
+g++ %CFLAGS% -c bias_point_class.cpp
+g++ %CFLAGS% -c builtin_tables.cpp
+g++ %CFLAGS% -c calendar_class.cpp
+g++ %CFLAGS% -c cache_func.cpp
+g++ %CFLAGS% -c carrier_class.cpp
+g++ %CFLAGS% -c device_properties.cpp
+g++ %CFLAGS% -c dev_prop_func.cpp
+g++ %CFLAGS% -c drift_velocity.cpp
+g++ %CFLAGS% -c functions.cpp
+g++ %CFLAGS% -c histogram_class.cpp
+g++ %CFLAGS% -c rng_class.cpp
+g++ %CFLAGS% -c ii_coef.cpp
+g++ %CFLAGS% -c main.cpp
+g++ %CFLAGS% -c SMC_class.cpp
+g++ %CFLAGS% -c tools_class.cpp
+g++ %CFLAGS% -c trace_class.cpp
+g++ %CFLAGS% -c trial_class.cpp
+g++ %CFLAGS% -c device_class.cpp
 
 
-g++ -o smc.exe main.o device_class.o carrier_class.o device_properties.o dev_prop_func.o drift_velocity.o functions.o histogram_class.o ii_coef.o SMC_class.o tools_class.o
+g++ %CFLAGS% -o smc.exe main.o bias_point_class.o builtin_tables.o cache_func.o calendar_class.o device_class.o carrier_class.o device_properties.o dev_prop_func.o drift_velocity.o functions.o histogram_class.o rng_class.o ii_coef.o SMC_class.o tools_class.o trace_class.o trial_class.o
 
 mkdir ..\run
 copy *.exe ..\run 
 del *.o
 del *.exe
+del builtin_tables.cpp
 echo "completed. smc.exe in ..\run folder"
@@ -0,0 +1,95 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   bias_point.h contains the class definition of the bias_point class for the SMC
+   A bias_point holds one bias of the device properties mode while its trials are run: its field profile,
+   output files and running totals, its trials are handed out in chunks of BIAS_CHUNK.
+
+   bias_point_class.cpp contains the class implimentation
+ */
+#ifndef BIAS_POINT_H
+#define BIAS_POINT_H
+#include "SMC.h"
+#include "device.h"
+#include "trial.h"
+#include "trace.h"
+#include <stdio.h>
+
+#define BIAS_CHUNK 16 //trials per chunk
+
+//Targets for stopping a bias before its last trial, a target of 0 is not used
+struct stopping {
+	double M;       //half width of the 95% interval of the gain, relative to the gain
+	double F;       //half width of the 95% interval of the excess noise factor, relative to F
+	double Pb;      //half width of the 95% interval of the breakdown probability
+	int min_trials; //trials before a bias can stop
+};
+
+class bias_point {
+private:
+	SMC *constants;
+	device *diode;       //copy of the device holding this bias's field profile
+	double Vsim;
+	int index;           //position in bias_input.txt
+	double Ntrials;
+	double BreakdownCurrent;
+	double timestep;
+	int CurrentArray;
+	int chunks;
+	int *ready;          //1 once a chunk has run
+	trial_result **result; //[chunks][BIAS_CHUNK], held until the chunk is added
+	trace **Ichunk;      //current of each chunk, the sum of its trials in trial order
+	trace *I;
+	trace *ITotalCurrent[10]; //current of trials 1 to 9
+	FILE *tbout;         //per bias output files, only open while fold() adds a chunk
+	FILE *Mout;
+	FILE *counter;
+	int Highest;
+	int cutoff;
+	double cumulative, gain, Ms, breakdown, events, selfevents;
+	double square;       //sum of the squared gains
+	int added;           //trials added to the totals
+	const stopping *rule; //NULL to run every trial
+	int batches;         //chunks added, the batches of the intervals of M and F
+	double by, byy, bz, bzz, byz; //sums of the batch mean gains y, their mean squares z and products
+	int returned;        //chunks run
+	void add(int num, trial_result *r);
+	FILE *open(const char *name, const char *mode);
+	int converged();
+public:
+	//scheduling, used under the scheduler's lock
+	int dispatched;      //chunks handed out
+	int folded;          //chunks added to the totals
+	int folding;         //1 while a thread is adding chunks
+	double cost;         //seconds spent running the chunks so far
+	int costed;          //trials in cost
+	int stopped;         //1 once the stopping targets are met, no more chunks are handed out
+	int allowed;         //chunks that may be handed out, all of them without a sweep budget
+	bias_point(SMC *con, device *shared, int bias_index, double voltage, int timeslice, double simulationtime, int trials, double breakdown_current, const stopping *targets);
+	~bias_point();
+	int Get_chunks();
+	int Get_ready(int c);
+	int Get_done();
+	int Get_trials();
+	double Get_V();
+	int run(int c, trial *engine);
+	void Input_ready(int c);
+	int fold(int c);
+	void interval(double *dM, double *dF, double *dPb);
+	double error();
+	void finish(FILE *out, FILE *errors);
+};
+#endif
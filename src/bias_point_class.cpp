@@ -0,0 +1,368 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   bias_point_class.cpp contains the class implimentation of the bias_point class for the SMC.
+
+   Writes the per bias output files <V>gain_out.txt, <V>time_to_breakdown.txt, <V>eventcounter.txt,
+   <V>current.txt and the line of the bias in Result_1.txt, with the intervals reached if stopping targets are set,
+   and in Result_3.txt under a sweep budget.
+
+   bias_point.h contains the class definition
+ */
+
+#include "bias_point.h"
+#include "functions.h"
+#include <math.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+//Constructor, sets up the field profile of bias bias_index from shared, the time bins and the output files
+//PUBLIC
+//targets are the stopping targets, NULL runs every trial
+bias_point::bias_point(SMC *con, device *shared, int bias_index, double voltage, int timeslice, double simulationtime, int trials, double breakdown_current, const stopping *targets) : constants(con){
+	index=bias_index;
+	Vsim=voltage;
+	Ntrials=trials;
+	BreakdownCurrent=breakdown_current;
+	diode=new device(*shared);
+	diode->Input_bias(index);//generates field profile for diode
+	printf("V= %g Width = %e \n", Vsim, diode->Get_width());
+	timestep=diode->Get_width()/((double)timeslice*1e5); //Time tracking step size in seconds
+	printf("V= %g timestep = %e \n", Vsim, timestep);
+	CurrentArray=(int)(simulationtime/timestep); // calculates number of timesteps required for simulationtime
+
+	int num;
+	for(num=0; num<10; num++) ITotalCurrent[num]=new trace(CurrentArray); //hold the current data of the first trials
+	I=new trace(CurrentArray);
+	chunks=(trials+BIAS_CHUNK-1)/BIAS_CHUNK;
+	ready=new int[chunks];
+	result=new trial_result*[chunks];
+	Ichunk=new trace*[chunks];
+	int c;
+	for(c=0; c<chunks; c++) {
+		ready[c]=0;
+		result[c]=NULL;
+		Ichunk[c]=NULL;
+	}
+	dispatched=0;
+	folded=0;
+	folding=0;
+	cost=0;
+	costed=0;
+	stopped=0;
+	allowed=chunks;
+	returned=0;
+	rule=targets;
+	batches=0;
+	by=0;
+	byy=0;
+	bz=0;
+	bzz=0;
+	byz=0;
+	//the output files of the bias are opened by fold() for each chunk, so a bias waiting to be written holds none
+	tbout=NULL;
+	Mout=NULL;
+	counter=NULL;
+	Highest=0;
+	cutoff=0;
+	cumulative=0;
+	events=0; //scattering events and the self-scatterings among them, all trials
+	selfevents=0;
+	breakdown=0;
+	Ms=0;
+	gain=0;
+	square=0;
+	added=0;
+};
+bias_point::~bias_point(){
+	int c;
+	for(c=0; c<chunks; c++) {
+		delete[] result[c];
+		delete Ichunk[c];
+	}
+	delete[] ready;
+	delete[] result;
+	delete[] Ichunk;
+	delete I;
+	for(c=0; c<10; c++) delete ITotalCurrent[c];
+	delete diode;
+};
+
+int bias_point::Get_chunks(){
+	return chunks;
+};
+//Returns 1 if chunk c has run, 0 past the last chunk
+int bias_point::Get_ready(int c){
+	return (c<chunks) ? ready[c] : 0;
+};
+//Returns 1 once every chunk has been added to the totals, or the bias has stopped and every chunk handed out has run
+int bias_point::Get_done(){
+	return folded==chunks || (stopped && returned==dispatched);
+};
+//Returns the number of trials added to the totals
+int bias_point::Get_trials(){
+	return added;
+};
+double bias_point::Get_V(){
+	return Vsim;
+};
+void bias_point::Input_ready(int c){
+	ready[c]=1;
+	returned++;
+};
+
+//run runs the trials of chunk c on engine and returns how many there were
+//PUBLIC
+int bias_point::run(int c, trial *engine){
+	engine->setup(diode,index,timestep,CurrentArray,BreakdownCurrent);
+	result[c]=new trial_result[BIAS_CHUNK];
+	Ichunk[c]=new trace(CurrentArray);
+	int t;
+	for(t=0; t<BIAS_CHUNK; t++) {
+		int num=c*BIAS_CHUNK+t+1;
+		if(num>Ntrials) break;
+		///PLOT THE Inum array. This gives the time vs. Current per trail.
+		engine->run(num,&result[c][t],Ichunk[c],(num<10) ? ITotalCurrent[num] : NULL);
+	}
+	return t;
+};
+
+//fold adds chunk c, the next chunk in trial order, to the totals and output files. Chunks finish in any order on
+//any thread and wait in result until the chunks before them are in, so the totals don't depend on the threads.
+//The output files are opened for the chunk and closed again. Returns 1 if the stopping targets are now met.
+//PUBLIC
+int bias_point::fold(int c){
+	int t;
+	double y=0, z=0;
+	const char *mode=(c==0) ? "w" : "a";
+	tbout=open("time_to_breakdown.txt",mode);
+	Mout=open("gain_out.txt",mode);
+	counter=open("eventcounter.txt",mode);
+	for(t=0; t<BIAS_CHUNK; t++) {
+		int num=c*BIAS_CHUNK+t+1;
+		if(num>Ntrials) break;
+		add(num,&result[c][t]);
+		y+=result[c][t].tn;
+		z+=result[c][t].tn*result[c][t].tn;
+	}
+	if(tbout!=NULL) fclose(tbout);
+	if(Mout!=NULL) fclose(Mout);
+	if(counter!=NULL) fclose(counter);
+	tbout=NULL;
+	Mout=NULL;
+	counter=NULL;
+	y/=t;
+	z/=t;
+	batches++;
+	by+=y;
+	byy+=y*y;
+	bz+=z;
+	bzz+=z*z;
+	byz+=y*z;
+	I->fold(Ichunk[c]);
+	delete[] result[c];
+	delete Ichunk[c];
+	result[c]=NULL;
+	Ichunk[c]=NULL;
+	return converged();
+};
+
+//interval gives the half widths of the 95% intervals of M, F and Pb from the trials added so far. M and F come
+//from the means of the chunks, F through the first order error of the ratio of the mean square gain to the
+//squared gain, with the Student t quantile for the number of chunks, Pb from the Wilson interval. HUGE_VAL until
+//there are two chunks.
+//PUBLIC
+void bias_point::interval(double *dM, double *dF, double *dPb){
+	static const double student[30]={12.706,4.303,3.182,2.776,2.571,2.447,2.365,2.306,2.262,2.228,2.201,2.179,2.160,2.145,
+		2.131,2.120,2.110,2.101,2.093,2.086,2.080,2.074,2.069,2.064,2.060,2.056,2.052,2.048,2.045,2.042}; //97.5% quantiles
+	const double z=1.96;
+	*dM=HUGE_VAL;
+	*dF=HUGE_VAL;
+	*dPb=HUGE_VAL;
+	if(added>0) {
+		double n=added;
+		double p=breakdown/n;
+		*dPb=z*sqrt(p*(1-p)/n+z*z/(4*n*n))/(1+z*z/n);
+	}
+	if(batches<2) return;
+	double B=batches;
+	double ym=by/B, zm=bz/B;
+	double vy=_max(byy-B*ym*ym,0)/(B-1);
+	double vz=_max(bzz-B*zm*zm,0)/(B-1);
+	double cyz=(byz-B*ym*zm)/(B-1);
+	double dy=-2*zm/(ym*ym*ym); //derivative of F=z/y^2
+	double dz=1/(ym*ym);
+	double t=(batches-1<=30) ? student[batches-2] : z;
+	*dM=t*sqrt(vy/B);
+	*dF=t*sqrt(_max(dy*dy*vy+dz*dz*vz+2*dy*dz*cyz,0)/B);
+};
+
+//converged returns 1 if the bias has stopping targets, has run min_trials and meets all of its targets.
+//It is checked as chunks are added in trial order, so a bias stops at the same trial for any number of threads.
+//PRIVATE
+int bias_point::converged(){
+	if(rule==NULL || added<rule->min_trials || added>=Ntrials) return 0;
+	return error()<=1;
+};
+
+//error returns the largest half width of the 95% intervals of M, F and Pb over its target, without targets M and F
+//are taken relative to their values and Pb absolute. HUGE_VAL until there are two chunks.
+//PUBLIC
+double bias_point::error(){
+	double dM,dF,dPb;
+	interval(&dM,&dF,&dPb);
+	if(batches<2) return HUGE_VAL;
+	double tM=1, tF=1, tPb=1;
+	if(rule!=NULL) {
+		tM=rule->M;
+		tF=rule->F;
+		tPb=rule->Pb;
+	}
+	double M=cumulative/added;
+	double F=(square/added)/(M*M);
+	double e=0;
+	if(tM>0) e=_max(e,dM/(tM*M));
+	if(tF>0) e=_max(e,dF/(tF*F));
+	if(tPb>0) e=_max(e,dPb/tPb);
+	return e;
+};
+
+//open opens the output file <V>name of the bias, prints an error and returns NULL if it can't
+//PRIVATE
+FILE *bias_point::open(const char *name, const char *mode){
+	char voltage[8]; //cut to the same length as the names postprocess() reads
+	snprintf(voltage,sizeof(voltage),"%g",Vsim);
+	char file[64];
+	snprintf(file,sizeof(file),"%s%s",voltage,name);
+	FILE *f=fopen(file,mode);
+	if(f==NULL) printf("Error: %s can't be opened\n",file);
+	return f;
+};
+
+//add adds trial num to the totals
+//PRIVATE
+void bias_point::add(int num, trial_result *r){
+	double tn=r->tn;
+	Highest=(int)_max(Highest,r->highest);
+	if(r->cutoff) cutoff=1;
+	events+=r->nph+r->nii+r->nsse+r->nssh;
+	selfevents+=r->nsse+r->nssh;
+	if(counter!=NULL) fprintf(counter,"%d %g %g %g %g\n",num,r->nph,r->nii,r->nsse,r->nssh);
+	gain+=tn/Ntrials; //accumilates average gain
+	Ms+=(tn*tn/Ntrials); //accumilates average Ms, used to calculate noise
+	cumulative+=tn; //tracks average gain so far in simulation
+	square+=tn*tn;
+	added=num;
+	double printer=cumulative/num;
+
+	if(r->breakdown_bin>=0) {
+		breakdown++;
+		double tb = timestep*r->breakdown_bin;
+		if(tbout!=NULL) fprintf(tbout,"%d %g\n",num,tb);
+	}
+	if(Mout!=NULL) fprintf(Mout, "%d %g %g\n",num, r->area, tn);
+	double Pbprint=breakdown/num;
+	if(!(num%100)) {
+		if(cutoff==0) printf("V= %g Completed trial: %d Gain=%f Pb=%f . Max array index=%d\n",Vsim,num,printer,Pbprint,Highest);
+		if(cutoff==1) printf("V= %g Completed trial: %d Cutoff Pb=%f  Max array index=%d\n",Vsim,num,Pbprint,Highest);
+	}
+};
+
+//finish writes the results of the bias once all its chunks are added, biases are finished in the order of bias_input.txt
+//PUBLIC
+//errors takes the trials run and the intervals reached, NULL if not wanted
+void bias_point::finish(FILE *out, FILE *errors){
+	//write the total current data to a file
+	std::string str1;//(100,'\0');
+	for(int num=0;num<10;num++)
+	{
+		std::ofstream fp_transient_current;
+		std::string fname(100,'\0');
+		std::snprintf(&fname[0],fname.size(),"%d_trial_current.txt",num);
+		fp_transient_current.open(fname);
+
+		for(int i=0; i<CurrentArray-1; i++)
+		{
+			char _t[32];
+			char _c[32];
+			std::snprintf(&_t[0],32,"%g",timestep*i);
+			std::snprintf(&_c[0],32,"%g",ITotalCurrent[num]->Get(i));
+			str1 = _t;
+			str1 += ',';
+			str1 += _c;
+			str1 += '\n';
+			fp_transient_current << str1;
+		}
+
+		fp_transient_current.close();
+	}
+
+	if(added<Ntrials) { //stopped early, gain and Ms were accumulated over Ntrials
+		gain=cumulative/added;
+		Ms=square/added;
+	}
+	double F=Ms/(gain*gain);
+	double Pbreakdown=breakdown/added;
+
+	if(cutoff==0) {
+		printf("V= %f M= %f, F= %f, Pb= %f \n",Vsim,gain,F,Pbreakdown);
+		fprintf(out,"V= %f M= %f F= %f, Pb= %f ",Vsim,gain,F,Pbreakdown);
+	}
+	else{
+		printf("V= %f M= cutoff, F= cutoff, Pb= %f \n",Vsim,Pbreakdown);
+		fprintf(out,"V= %f M= cutoff F= cutoff, Pb= %f ",Vsim,Pbreakdown);
+	}
+	if(rule!=NULL) {
+		//the half widths of the 95% intervals reached and the trials run
+		double dM,dF,dPb;
+		interval(&dM,&dF,&dPb);
+		printf("V= %g trials= %d dM= %g dF= %g dPb= %g\n",Vsim,added,dM,dF,dPb);
+		fprintf(out,"trials= %d dM= %g dF= %g dPb= %g ",added,dM,dF,dPb);
+	}
+	fprintf(out,"\n");
+	if(errors!=NULL) {
+		double dM,dF,dPb;
+		interval(&dM,&dF,&dPb);
+		fprintf(errors,"%g %d %g %g %g\n",Vsim,added,dM,dF,dPb);
+		fflush(errors);
+	}
+	printf("V= %g Self-scattering fraction= %f \n",Vsim,selfevents/events);
+	fflush(out);
+	FILE *Iout;
+	if(breakdown==0 && (Iout=open("current.txt","w"))!=NULL) {
+		fprintf(Iout,"V= %f \n", Vsim);
+		fprintf(Iout,"time step size in %e s\n",timestep);
+		fprintf(Iout,"t                I \n");
+		int Ioutprint =0;
+		int i;
+		for(i=0; i<CurrentArray; i++) {
+			double timeprint=timestep*i;
+			double current = I->Get(i)/(double)added;
+			if(I->Get(i)>0 && Ioutprint <50) {
+				fprintf(Iout,"%g %g \n",timeprint,current);
+				Ioutprint=0;
+			}
+			else if(Ioutprint <50) {
+				fprintf(Iout,"%g %g \n",timeprint,current);
+				Ioutprint++;
+			}
+		}
+		fflush(Iout);
+		fclose(Iout);
+	}
+};
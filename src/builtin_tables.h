@@ -0,0 +1,39 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   builtin_tables.h declares the scattering probability tables of the built-in materials.
+
+   builtin_tables.cpp is generated by table_gen.cpp as a step of Makefile.bat, the tables are
+   calculated once at build time and compiled into smc as read-only data.
+   Used by the tools class when the parameter set matches one of the built-in materials.
+ */
+
+#ifndef BUILTIN_TABLES_H
+#define BUILTIN_TABLES_H
+#include <stdint.h>
+
+struct builtin_table {
+	uint64_t key;      //tools table key of the parameter set
+	int points;        //energy points per mechanism
+	double rtotal;
+	double rtotal2;
+	const double *bins; //scatter_bin records, PB_RECORD doubles per energy point
+};
+
+extern const builtin_table builtin_tables[];
+extern const int builtin_table_count;
+
+#endif
@@ -0,0 +1,130 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   cache_func.cpp contains the function definitions for the binary cache files shared between runs.
+
+   function prototypes in cache_func.h
+ */
+
+#include "cache_func.h"
+#include "functions.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//64 bit FNV-1a hash
+uint64_t hash_bytes(const void *data, size_t size, uint64_t h){
+	const unsigned char *p=(const unsigned char *)data;
+	size_t i;
+	for(i=0; i<size; i++) {
+		h^=p[i];
+		h*=1099511628211ULL;
+	}
+	return h;
+};
+
+uint64_t hash_double(double x, uint64_t h){
+	return hash_bytes(&x,sizeof(x),h);
+};
+
+//The cache directory is set by table_cache_dir in smc_options.txt, default is the working directory
+void cache_filename(const char *prefix, uint64_t key, char *name, int size){
+	char dir[256];
+	if(read_option_text("table_cache_dir",dir,sizeof(dir)))
+		snprintf(name,size,"%s/%s_%016llx.bin",dir,prefix,(unsigned long long)key);
+	else
+		snprintf(name,size,"%s_%016llx.bin",prefix,(unsigned long long)key);
+};
+
+int map_file(const char *filename, mapped_file *map){
+	map->data=NULL;
+	map->size=0;
+#ifdef _WIN32
+	HANDLE file=CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(file==INVALID_HANDLE_VALUE) return 0;
+	LARGE_INTEGER length;
+	if(!GetFileSizeEx(file,&length) || length.QuadPart==0) {
+		CloseHandle(file);
+		return 0;
+	}
+	HANDLE mapping=CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+	CloseHandle(file);
+	if(mapping==NULL) return 0;
+	const void *view=MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+	CloseHandle(mapping); //the view keeps the mapping alive
+	if(view==NULL) return 0;
+	map->data=view;
+	map->size=(size_t)length.QuadPart;
+#else
+	int fd=open(filename,O_RDONLY);
+	if(fd<0) return 0;
+	struct stat info;
+	if(fstat(fd,&info)!=0 || info.st_size==0) {
+		close(fd);
+		return 0;
+	}
+	void *view=mmap(NULL,(size_t)info.st_size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd); //the mapping keeps the file open
+	if(view==MAP_FAILED) return 0;
+	map->data=view;
+	map->size=(size_t)info.st_size;
+#endif
+	return 1;
+};
+
+void unmap_file(mapped_file *map){
+	if(map->data==NULL) return;
+#ifdef _WIN32
+	UnmapViewOfFile(map->data);
+#else
+	munmap((void *)map->data,map->size);
+#endif
+	map->data=NULL;
+	map->size=0;
+};
+
+//Several runs, or several threads of one run, may build the same cache at once. Each write goes to its own
+//temporary file, named by the process and a count of the writes in it, and is renamed into place. If another
+//write got there first the rename fails on Windows and its copy is kept, which is not an error.
+int write_cache(const char *filename, const void *header, size_t header_size, const void *data, size_t data_size){
+	static int writes=0;
+	int write;
+	#pragma omp atomic capture
+	write=writes++;
+	char temp[300];
+	snprintf(temp,sizeof(temp),"%s.%d.%d.tmp",filename,(int)getpid(),write);
+	FILE *out;
+	if((out=fopen(temp,"wb"))==NULL) return 0;
+	int ok=(fwrite(header,1,header_size,out)==header_size);
+	ok=ok && (fwrite(data,1,data_size,out)==data_size);
+	ok=(fclose(out)==0) && ok;
+	if(ok && rename(temp,filename)==0) return 1;
+	remove(temp);
+	if(ok && (out=fopen(filename,"rb"))!=NULL) {
+		fclose(out);
+		return 1;
+	}
+	return 0;
+};
@@ -0,0 +1,56 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   cache_func.h contains the function prototypes for the binary cache files shared between runs.
+   Cache files are keyed by a hash of everything that went into them, written once and then
+   memory mapped read-only so concurrent runs on one machine share the same pages.
+
+   functions are implimented in cache_func.cpp
+ */
+
+#ifndef CACHE_FUNC_H
+#define CACHE_FUNC_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_HASH_START 14695981039346656037ULL //FNV-1a offset basis
+
+//A read-only view of a whole file
+struct mapped_file {
+	const void *data;
+	size_t size;
+};
+
+//Adds size bytes from data to the 64 bit FNV-1a hash h
+uint64_t hash_bytes(const void *data, size_t size, uint64_t h);
+
+//Adds a double to the hash h
+uint64_t hash_double(double x, uint64_t h);
+
+//Builds the cache file name prefix_<key>.bin inside the cache directory from smc_options.txt
+void cache_filename(const char *prefix, uint64_t key, char *name, int size);
+
+//Maps filename read-only into map, returns 0 if the file can't be opened or mapped
+int map_file(const char *filename, mapped_file *map);
+
+//Releases a mapping made by map_file
+void unmap_file(mapped_file *map);
+
+//Writes header then data to filename through a temporary file so readers never see a partial file.
+//Returns 0 on failure.
+int write_cache(const char *filename, const void *header, size_t header_size, const void *data, size_t data_size);
+
+#endif
@@ -0,0 +1,51 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   calendar.h contains the class definition of the calendar class for the SMC
+   The calendar class is a calendar queue of the carriers of a trial, bucketed by the time bin their next
+   flight starts in.
+
+   calendar_class.cpp contains the class implimentation
+ */
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#define CALENDAR_BINS 64 //time bins held in the ring
+
+class calendar {
+private:
+	int *entry[CALENDAR_BINS]; //carriers waiting in each bucket of the ring, taken out in the order they went in
+	int count[CALENDAR_BINS];
+	int size[CALENDAR_BINS];
+	int base;     //earliest bin the ring holds, in bucket base%CALENDAR_BINS
+	int *far_id;  //carriers CALENDAR_BINS or more bins past base, and their bins
+	int *far_bin;
+	int nfar, far_size;
+	int far_min;  //earliest bin in the far list
+	int waiting;
+	int bin;      //bin of the last take()
+	void push(int bucket, int id);
+	void advance(int first);
+public:
+	calendar();
+	~calendar();
+	void clear(int first); //empties the calendar, first is the earliest bin that will be added
+	void add(int id, int time_bin);
+	int take(int **list, int *list_size);
+	int Get_waiting();
+	int Get_bin();
+};
+#endif
@@ -0,0 +1,153 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   calendar_class.cpp contains the class implimentation of the calendar class for the SMC.
+
+   calendar.h contains the class definition
+ */
+
+#include "calendar.h"
+#include <string.h>
+
+//Constructor, the buckets start empty and grow as carriers are added
+//PUBLIC
+calendar::calendar(){
+	int b;
+	for(b=0; b<CALENDAR_BINS; b++) {
+		entry[b]=NULL;
+		count[b]=0;
+		size[b]=0;
+	}
+	far_id=NULL;
+	far_bin=NULL;
+	far_size=0;
+	clear(0);
+};
+calendar::~calendar(){
+	int b;
+	for(b=0; b<CALENDAR_BINS; b++) delete[] entry[b];
+	delete[] far_id;
+	delete[] far_bin;
+};
+
+//clear empties the calendar, keeping its buckets, first is the earliest bin that will be added
+//PUBLIC
+void calendar::clear(int first){
+	int b;
+	for(b=0; b<CALENDAR_BINS; b++) count[b]=0;
+	nfar=0;
+	far_min=0;
+	waiting=0;
+	base=first;
+	bin=first;
+};
+
+//push adds carrier id to the end of a bucket of the ring
+//PRIVATE
+void calendar::push(int bucket, int id){
+	if(count[bucket]==size[bucket]) {
+		int grown=2*size[bucket]+64;
+		int *array=new int[grown];
+		if(count[bucket]) memcpy(array,entry[bucket],count[bucket]*sizeof(int));
+		delete[] entry[bucket];
+		entry[bucket]=array;
+		size[bucket]=grown;
+	}
+	entry[bucket][count[bucket]++]=id;
+};
+
+//add files carrier id under time_bin, time bins before the earliest one still to come are filed under it
+//PUBLIC
+void calendar::add(int id, int time_bin){
+	if(time_bin<base) time_bin=base;
+	waiting++;
+	if(time_bin<base+CALENDAR_BINS) {
+		push(time_bin%CALENDAR_BINS,id);
+		return;
+	}
+	if(nfar==far_size) {
+		int grown=2*far_size+64;
+		int *ids=new int[grown];
+		int *bins=new int[grown];
+		if(nfar) {
+			memcpy(ids,far_id,nfar*sizeof(int));
+			memcpy(bins,far_bin,nfar*sizeof(int));
+		}
+		delete[] far_id;
+		delete[] far_bin;
+		far_id=ids;
+		far_bin=bins;
+		far_size=grown;
+	}
+	if(nfar==0 || time_bin<far_min) far_min=time_bin;
+	far_id[nfar]=id;
+	far_bin[nfar]=time_bin;
+	nfar++;
+};
+
+//advance moves the ring on to start at bin first and brings in the far carriers it now reaches, in the order they were added
+//PRIVATE
+void calendar::advance(int first){
+	base=first;
+	if(nfar==0 || far_min>=base+CALENDAR_BINS) return;
+	int k, n=0;
+	far_min=0;
+	for(k=0; k<nfar; k++) {
+		if(far_bin[k]<base+CALENDAR_BINS) push(far_bin[k]%CALENDAR_BINS,far_id[k]);
+		else {
+			if(n==0 || far_bin[k]<far_min) far_min=far_bin[k];
+			far_id[n]=far_id[k];
+			far_bin[n]=far_bin[k];
+			n++;
+		}
+	}
+	nfar=n;
+};
+
+//take moves the carriers of the earliest bin with any into list, grown as needed, and returns how many there were.
+//Get_bin() then gives their bin, the carriers added afterwards must be in a later bin.
+//PUBLIC
+int calendar::take(int **list, int *list_size){
+	if(waiting==0) return 0;
+	int b;
+	while(1) {
+		for(b=base; b<base+CALENDAR_BINS; b++) {
+			if(count[b%CALENDAR_BINS]) break;
+		}
+		if(b<base+CALENDAR_BINS) break;
+		advance(far_min); //the ring is empty, skips ahead to the far carriers
+	}
+	int bucket=b%CALENDAR_BINS;
+	int n=count[bucket];
+	if(*list_size<n) {
+		delete[] *list;
+		*list_size=n;
+		*list=new int[n];
+	}
+	memcpy(*list,entry[bucket],n*sizeof(int));
+	count[bucket]=0;
+	waiting-=n;
+	bin=b;
+	advance(b+1);
+	return n;
+};
+
+int calendar::Get_waiting(){
+	return waiting;
+};
+int calendar::Get_bin(){
+	return bin;
+};
@@ -16,6 +16,7 @@
 /*
    carrier.h contains the class implimentation for the carrier class for the SMC
    The carrier class contains all the information about the carriers as they travel through the device
+   Each quantity is held in its own array indexed by carrier number starting from 1.
 
    carrer_class.cpp contains the class definition
 
@@ -24,19 +25,33 @@
 
 #ifndef CARRIER_H
 #define CARRIER_H
-#define Array 1000000 // Statically allocated max number of electrons or holes to track.
+#define CARRIER_START 1024 // carriers allocated by the constructor, the arrays double in size when more are needed
 #include "SMC.h"
+#include "rng.h"
 class carrier {
 private:
-	double position[Array];
-	double Egy[Array];
-	double kxy[Array];
-	double kz[Array];
-	int scattering[Array];
-	double time[Array];
-	double dt[Array];
-	double dx[Array];
-	int timearray[Array];
+	double *position;
+	double *Egy;
+	double *kxy;
+	double *kz;
+	int *scattering;
+	double *time;
+	double *dt;
+	double *dx;
+	int *timearray;
+	double *weight; //number of real carriers this carrier stands for
+	int *active;  //numbers of the carriers still in the device
+	int *slot;    //entry of each carrier in the active list
+	int nactive;
+	int capacity; //entries in each array
+	int used;     //highest carrier number started since the last reset, reset() only clears up to it
+	void grow(int i);
+	void clear(int first, int last);
+	//makes room for carrier i and records it in the high-water mark
+	inline void start(int i){
+		if(i>=capacity) grow(i);
+		if(i>used) used=i;
+	};
 	SMC *constants;
 	double hmass;
 	double emass;
@@ -61,9 +76,34 @@ public:
 	void Input_dx(int i, double input);
 	double Get_dx(int i);
 	void reset();
+	//adds carrier i to the active list
+	inline void activate(int i){
+		slot[i]=nactive;
+		active[nactive++]=i;
+	};
+	//removes entry k of the active list, the last entry takes its place
+	inline void deactivate(int k){
+		int last=active[--nactive];
+		active[k]=last;
+		slot[last]=k;
+	};
+	//removes carrier i from the active list
+	inline void remove(int i){
+		deactivate(slot[i]);
+	};
+	inline int Get_active(int k){
+		return active[k];
+	};
+	inline int Get_nactive(){
+		return nactive;
+	};
 	void Input_timearray(int i, int input);
 	int Get_timearray(int i);
-	void scatter(int i, int j);
-	void generation(int i, double z_pos, double Egy, double time, double dt, int timearray);
+	void Input_weight(int i, double input);
+	double Get_weight(int i);
+	void scatter(int i, int j, rng *random);
+	void generation(int i, double z_pos, double Egy, double time, double dt, int timearray, double weight);
+	void merge(rng *random);
+	int split(int target, int last);
 };
 #endif
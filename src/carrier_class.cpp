@@ -23,26 +23,69 @@
  */
 
 #include "carrier.h"
-#include "functions.h"
+#include "rng.h"
 #include "math.h"
+#include <string.h>
+#include <algorithm>
+
+//Active carrier sorted by position in merge()
+struct carrier_order {
+	double pos;
+	int i;
+	bool operator<(const carrier_order &other) const {
+		return pos<other.pos;
+	};
+};
 //All these functions are for Get, Set and Zero.
 carrier::carrier(SMC *input) : constants(input){
-	int i;
 	emass= constants->Get_e_mass();
 	hmass= constants->Get_h_mass();
 	hbar=constants->Get_hbar();
-	for(i=1; i<(Array+1); i++)
-	{    position[i]=0;
-		 Egy[i]=0;
-		 kxy[i]=0;
-		 kz[i]=0;
-		 scattering[i]=0;
-		 dt[i]=0;
-		 dx[i]=0;
-		 time[i]=0;
-		 timearray[i]=0;}
+	capacity=0;
+	used=0;
+	nactive=0;
+	active=NULL;
+	slot=NULL;
+	position=NULL;
+	Egy=NULL;
+	kxy=NULL;
+	kz=NULL;
+	scattering=NULL;
+	time=NULL;
+	dt=NULL;
+	dx=NULL;
+	timearray=NULL;
+	weight=NULL;
+	grow(CARRIER_START-1);
+};
+//Copies an array into a new one of size entries, the new entries are zeroed
+template <typename T> static T *resize(T *old, int oldsize, int size){
+	T *array=new T[size];
+	if(old!=NULL) memcpy(array,old,oldsize*sizeof(T));
+	memset(array+oldsize,0,(size-oldsize)*sizeof(T));
+	delete[] old;
+	return array;
+};
+//Enlarges the arrays so carrier i fits, at least doubling them so a large avalanche only grows them a few times
+void carrier::grow(int i){
+	int size=2*capacity;
+	if(size<i+1) size=i+1;
+	position=resize(position,capacity,size);
+	Egy=resize(Egy,capacity,size);
+	kxy=resize(kxy,capacity,size);
+	kz=resize(kz,capacity,size);
+	scattering=resize(scattering,capacity,size);
+	time=resize(time,capacity,size);
+	dt=resize(dt,capacity,size);
+	dx=resize(dx,capacity,size);
+	timearray=resize(timearray,capacity,size);
+	weight=resize(weight,capacity,size);
+	active=resize(active,capacity,size); //a carrier is only in the active list once so it needs no more room
+	slot=resize(slot,capacity,size);
+	capacity=size;
 };
 void carrier::Input_pos(int i, double input){
+	start(i);
 	position[i]=input;
 };
 void carrier::Input_Egy(int i, double input){
@@ -73,6 +116,18 @@ int carrier::Get_scattering(int i){
 	return scattering[i];
 };
 carrier::~carrier(){
+	delete[] position;
+	delete[] Egy;
+	delete[] kxy;
+	delete[] kz;
+	delete[] scattering;
+	delete[] time;
+	delete[] dt;
+	delete[] dx;
+	delete[] timearray;
+	delete[] weight;
+	delete[] active;
+	delete[] slot;
 };
 void carrier::Input_time(int i, double input){
 	time[i]=input;
@@ -92,43 +147,109 @@ void carrier::Input_dx(int i, double input){
 double carrier::Get_dx(int i){
 	return dx[i];
 };
-// Resets all the arrays to 0.
+// Resets the carriers used since the last reset to 0, the rest of the arrays are still 0. Empties the active list.
 void carrier::reset(){
-	int i;
-	for(i=1; i<(Array+1); i++)
-	{    position[i]=0;
-		 Egy[i]=0;
-		 kxy[i]=0;
-		 kz[i]=0;
-		 scattering[i]=0;
-		 dt[i]=0;
-		 dx[i]=0;
-		 time[i]=0;
-		 timearray[i]=0;}
+	clear(1,used);
+	used=0;
+	nactive=0;
+};
+//Zeroes carriers first to last
+void carrier::clear(int first, int last){
+	if(last<first) return;
+	int n=last-first+1;
+	memset(position+first,0,n*sizeof(double));
+	memset(Egy+first,0,n*sizeof(double));
+	memset(kxy+first,0,n*sizeof(double));
+	memset(kz+first,0,n*sizeof(double));
+	memset(scattering+first,0,n*sizeof(int));
+	memset(time+first,0,n*sizeof(double));
+	memset(dt+first,0,n*sizeof(double));
+	memset(dx+first,0,n*sizeof(double));
+	memset(timearray+first,0,n*sizeof(int));
+	memset(weight+first,0,n*sizeof(double));
 };
+
 void carrier::Input_timearray(int i, int input){
 	timearray[i]=input;
 };
 int carrier::Get_timearray(int i){
 	return timearray[i];
 };
+void carrier::Input_weight(int i, double input){
+	weight[i]=input;
+};
+double carrier::Get_weight(int i){
+	return weight[i];
+};
 
 //Calculates the new scattering direction and momenta
-void carrier::scatter(int i, int j){
+void carrier::scatter(int i, int j, rng *random){
 	double cos_theta,kf;
 	if (j==0 ) kf=2*(emass)*Egy[i]/((hbar)*(hbar));
 	else kf=2*(hmass)*Egy[i]/((hbar)*(hbar));
 	if(kf>=0) {
-		cos_theta=2*genrand()-1;
+		cos_theta=2*random->genrand()-1;
 		kz[i]=cos_theta*sqrt(kf);
 		kxy[i]=kf*(1-cos_theta*cos_theta);
 	}
 };
 //Generates a new carrier after an impact ionization event
-void carrier::generation(int i, double z_pos, double Energy, double timein, double dtin, int timearrayin){
+void carrier::generation(int i, double z_pos, double Energy, double timein, double dtin, int timearrayin, double weightin){
+	start(i);
+	weight[i]=weightin;
 	position[i]=z_pos;
 	Egy[i]=Energy;
 	time[i]=timein;
 	dt[i]=dtin;
 	timearray[i]=timearrayin;
 };
+//Halves the number of active carriers. Carriers are paired with their neighbour in position and one of each pair
+//is kept with the weight of both, chosen in proportion to their weights so the expected current and gain are unchanged.
+void carrier::merge(rng *random){
+	int k, n=0;
+	carrier_order *order=new carrier_order[nactive];
+	for(k=0; k<nactive; k++) {
+		order[k].pos=position[active[k]];
+		order[k].i=active[k];
+	}
+	std::sort(order,order+nactive);
+	for(k=0; k+1<nactive; k+=2) {
+		int a=order[k].i;
+		int b=order[k+1].i;
+		double w=weight[a]+weight[b];
+		int keep=(random->genrand()*w<weight[a]) ? a : b;
+		weight[keep]=w;
+		slot[keep]=n;
+		active[n++]=keep;
+	}
+	if(nactive%2) {
+		slot[order[nactive-1].i]=n;
+		active[n++]=order[nactive-1].i;
+	}
+	nactive=n;
+	delete[] order;
+};
+//Splits active carriers of weight 2 or more into two identical carriers of half the weight until target carriers
+//are active. The new carriers are numbered on from last, returns the last number used.
+int carrier::split(int target, int last){
+	int k, n=nactive;
+	for(k=0; k<n && nactive<target; k++) {
+		int j=active[k];
+		if(weight[j]<2) continue;
+		last++;
+		start(last);
+		position[last]=position[j];
+		Egy[last]=Egy[j];
+		kxy[last]=kxy[j];
+		kz[last]=kz[j];
+		scattering[last]=scattering[j];
+		time[last]=time[j];
+		dt[last]=dt[j];
+		dx[last]=dx[j];
+		timearray[last]=timearray[j];
+		weight[j]*=0.5;
+		weight[last]=weight[j];
+		activate(last);
+	}
+	return last;
+};
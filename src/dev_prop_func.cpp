@@ -93,17 +93,23 @@ void postprocess(double Vsim[],double simtime, int voltages){
 		snprintf(fileM,fileM_len,"%s%s",voltagetb,nameM);
 		Mout=fopen(fileM,"r");
 		delete[] fileM;
-		int event, count, count2;
-		double scanned, TGain, Gain2,mgain2;
+		if(Mout==NULL) {
+			printf("Error: %sgain_out.txt can't be opened\n",voltagetb);
+			fprintf(results,"%lf -- -- --\n",V);
+			continue;
+		}
+		int event, count;
+		double scanned, count2, TGain, Gain2,mgain2; //count2 is fractional for weighted carriers
 		TGain=0;
 		Gain2=0;
 		count=0;
-		while((fscanf(Mout,"%d %lf %d\n",&event, &scanned, &count2))>0) {
+		while((fscanf(Mout,"%d %lf %lf\n",&event, &scanned, &count2))==3) {
 			//scanned=scanned/1.6e-19;
 			TGain+=scanned;
 			Gain2+=scanned*scanned;
 			count++;
 		}
+		if(!feof(Mout)) printf("Error: %sgain_out.txt can't be read after line %d, Result_2.txt only uses the lines before\n",voltagetb,count);
 		G[i]=TGain/count;
 		mgain2=Gain2/count;
 		F[i]=mgain2/(G[i]*G[i]);
@@ -122,7 +128,6 @@ void postprocess(double Vsim[],double simtime, int voltages){
 			}
 			if(count>0) {
 				double *data = new double[count];
-				data = { 0 };
 				rewind(Tout);
 				count=0;
 				while(fscanf(Tout,"%d %lf\n",&dump,&dump2)>0) {
@@ -130,12 +135,12 @@ void postprocess(double Vsim[],double simtime, int voltages){
 					count++;
 				}
 				fclose(Tout);
-				delete[] data;
 				char nameH[]="Hist.txt";
 				int fileH_len = strlen(voltagetb) + strlen(nameH) + 1;
 				char *fileH = new char[fileH_len];
 				snprintf(fileH, fileH_len,"%s%s",voltagetb,nameH);
 				histogram hist(data,count,0.1,fileH);
+				delete[] data;
 				delete[] fileH;
 				T[i]=hist.Get_Mean();
 				fprintf(results,"%lf %lf %lf %lf\n",Vsim[i],G[i],F[i],T[i]);
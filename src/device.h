@@ -16,8 +16,8 @@
 /*
    device.h contains the class implimentation of the device class for the SMC.
 
-   The device class contains a Poisson solver and a linear interpolater to claculate the
-   electric field properties of semiconductor devices.
+   The device class solves the electric field profile of semiconductor devices in the full depletion
+   approximation and looks up the field at a position.
 
    device_class.cpp contains the class definition
 
@@ -27,6 +27,7 @@
 #ifndef DEVICE_H
 #define DEVICE_H
 #include "SMC.h"
+#include "cache_func.h"
 
 class device {
 private:
@@ -38,19 +39,50 @@ private:
 	double *efield_e;
 	double *N;
 	double *w;
+	double *X;    //position of each layer boundary
+	double *Q;    //charge per unit area between the peak field boundary and each layer boundary (m-2)
+	double *P;    //integral of Q from the peak field boundary (m-1)
+	double *Qmin; //lowest Q between the peak field boundary and each layer boundary
+	int peak;     //layer boundary where the field peaks, Q is highest there
+	double sign;  //1 if the profile starts with positive doping, -1 if negative
+	double last;  //charge level of the last profile, the starting point of the next solve
+	uint64_t doping_key; //hash of doping_profile.txt and the material, the field cache key adds the bias
+	int usecache;
+	int nbias;
+	double *bias_v;   //biases given to solve()
+	double *bias_c;   //their charge levels, only solved if not in the field cache
+	int *bias_cached;
+	int copy;     //1 for a copy, the biases belong to the device it was copied from
+	int shared;   //1 while the doping profile belongs to the device it was copied from
 	int i_max;
 	int i_min;
+	double *slope;     //field gradient of each segment of the profile
+	int *cell_segment; //segment at the start of each lookup cell
+	int cells;
+	double cell_scale; //lookup cells per metre
+	void lookup();
 	double die;
 	double q;
-	double LinearInterpolate(double y1, double y2, double x1, double x2, double x);
 	void read();
-	int depletionlookup();
+	void allocate(int layers);
+	uint64_t field_key(double voltage);
+	int load_field(double voltage, int check);
+	void write_field(double voltage);
+	void charge();
+	double depletion(double c, int *left, int *right, double *a, double *b);
+	double level(double voltage, double guess);
+	device &operator=(const device &from); //not defined, a device can only be copied by the copy constructor
 public:
 	device(SMC *con);
+	device(const device &from); //shares the doping profile and biases of from but holds its own field profile
+	~device();
 	double Efield_at_x(double xpos);  //returns the Efield for a given position
 	double Get_width();
 	double Get_xmin();
 	double Get_xmax();
 	void profiler(double voltage);
+	void solve(const double *voltage, int n); //field solutions of a list of biases, solved in parallel
+	void Input_bias(int i); //sets the field profile to bias i of solve()
+	void Input_level(double c); //sets the field profile to the depletion region at charge level c
 };
 #endif
@@ -16,8 +16,8 @@
 /*
    device_class.cpp contains the class definition of the device class for the SMC.
 
-   The device class contains a Poisson solver and a linear interpolater to claculate the
-   electric field properties of semiconductor devices.
+   The device class solves the electric field profile of semiconductor devices in the full depletion
+   approximation and looks up the field at a position.
 
    device.cpp contains the class implimentation
 
@@ -25,39 +25,118 @@
  */
 
 #include "device.h"
+#include "functions.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <conio.h>
-//Constructor, sets a few variables and calls read() to read in and populate the doping profile.
+#define FIELD_VERSION 1 //change when the solver or the layout of the field cache change
+//Header of a field cache file, followed by efield_x, efield_e and slope from i_min to i_max and cell_segment
+struct field_header {
+	char magic[8];
+	int version;
+	int layers;
+	int i_min;
+	int i_max;
+	int cells;
+	int pad;
+	uint64_t key;
+	double cell_scale;
+	double voltage;
+	double level;
+};
+
+//Constructor, sets a few variables and hashes doping_profile.txt for the field cache. The doping profile is
+//only read in by read() once a field has to be solved.
 //PUBLIC
 device::device(SMC *input) : constants(input){
 	q=constants->Get_q();
 	Vbi=constants->Get_Vbi();
 	double d1=constants->Get_die();
 	die=d1*8.85e-12;
-	read();
+	cell_segment=NULL;
+	cells=0;
+	last=1; //no previous profile
+	NumLayers=0;
+	N=NULL;
+	w=NULL;
+	X=NULL;
+	Q=NULL;
+	P=NULL;
+	Qmin=NULL;
+	efield_x=NULL;
+	efield_e=NULL;
+	slope=NULL;
+	nbias=0;
+	bias_v=NULL;
+	bias_c=NULL;
+	bias_cached=NULL;
+	copy=0;
+	shared=0;
+	usecache=(read_option("field_cache",1)!=0);
+	FILE* doping;
+	int inputkey;
+	if ((doping=fopen("doping_profile.txt","rb"))==NULL) {
+		printf("Error: Can't open doping profile\n");
+		printf("Press space to exit\n");
+		while((inputkey=_getch())==0);
+	}
+	uint64_t h=CACHE_HASH_START;
+	int version=FIELD_VERSION;
+	int grid=read_option("doping_grid",0)!=0;
+	h=hash_bytes(&version,sizeof(version),h);
+	h=hash_bytes(&grid,sizeof(grid),h);
+	h=hash_double(q,h);
+	h=hash_double(die,h);
+	h=hash_double(Vbi,h);
+	char buffer[65536];
+	size_t n;
+	while((n=fread(buffer,1,sizeof(buffer),doping))>0) h=hash_bytes(buffer,n,h);
+	fclose(doping);
+	doping_key=h;
+};
+
+//Copy constructor, the copy reads the doping profile and biases of from and has its own field profile arrays.
+//from must outlive the copy and not call solve() again while it exists.
+//PUBLIC
+device::device(const device &from) : constants(from.constants), NumLayers(from.NumLayers), Vbi(from.Vbi), width(from.width),
+	efield_x(NULL), efield_e(NULL), N(from.N), w(from.w), X(from.X), Q(from.Q), P(from.P), Qmin(from.Qmin),
+	peak(from.peak), sign(from.sign), last(from.last), doping_key(from.doping_key), usecache(from.usecache),
+	nbias(from.nbias), bias_v(from.bias_v), bias_c(from.bias_c), bias_cached(from.bias_cached), copy(1), shared(1),
+	i_max(from.i_max), i_min(from.i_min), slope(NULL), cell_segment(NULL), cells(0), cell_scale(from.cell_scale),
+	die(from.die), q(from.q){
+	if(from.efield_x!=NULL) allocate(NumLayers);
+};
+device::~device(){
+	delete[] efield_x;
+	delete[] efield_e;
+	delete[] slope;
+	delete[] cell_segment;
+	if(!shared) {
+		delete[] N;
+		delete[] w;
+		delete[] X;
+		delete[] Q;
+		delete[] P;
+		delete[] Qmin;
+	}
+	if(!copy) {
+		delete[] bias_v;
+		delete[] bias_c;
+		delete[] bias_cached;
+	}
 };
 
 //Efield_at_x returns the electric field to main for a given xposition inside
 //the electric field profile. If outside the electric field profile it will return 0.
 //PUBLIC
 double device::Efield_at_x(double xpos){
-	double Field;
-
-	int i,j;
-	for(i=i_min; i<i_max; i++)
-	{
-		if (xpos>=efield_x[i])
-		{
-			j=i+1;
-			if(xpos<efield_x[j])
-			{
-				Field = LinearInterpolate(efield_e[i], efield_e[j], efield_x[i],efield_x[j],xpos);
-				return Field;
-			}
-		}
-	}
-	return 0;
+	if(!(xpos>=efield_x[i_min] && xpos<efield_x[i_max])) return 0;
+	int c=(int)((xpos-efield_x[i_min])*cell_scale);
+	if(c>=cells) c=cells-1;
+	int i=cell_segment[c];
+	while(xpos>=efield_x[i+1]) i++; //a cell can hold the end of a segment, never past i_max as xpos<efield_x[i_max]
+	return efield_e[i]+slope[i]*(xpos-efield_x[i]);
 };
 //Get function to return the depletion width.
 //PUBLIC
@@ -70,19 +149,12 @@ double device::Get_xmin(){
 double device::Get_xmax(){
 	return efield_x[i_max];
 };
-//Linear Interpolator used by Efield_at_x
-//PRIVATE
-double device::LinearInterpolate(double y1, double y2, double x1, double x2, double x){
-	double mu, ans;
-	mu = (x-x1)/(x2-x1);
-	ans= (y1*(1-mu)+y2*mu);
-	return ans;
-};
 
 
 //read, populates the doping profile, declares the size of arrays that depend on the doping profile
-//Shifts the doping profile read in as cm-3, um to m-3, m and populates the check voltages.
-//The check voltages are the points that the device fully depetes regions, i.e. 0 is 2 regions, 1 is 3 regions etc.
+//Shifts the doping profile read in as cm-3, um to m-3, m and sets up the charge sums used by profiler.
+//With doping_grid 1 each line is a grid point x(um),N(cm-3), as exported from TCAD, and each pair of
+//neighbouring points becomes a layer with their mean doping, so the field is solved on the same grid.
 //PRIVATE
 void device::read(){
 	NumLayers=0;
@@ -93,186 +165,336 @@ void device::read(){
 		printf("Press space to exit\n");
 		while((inputkey=_getch())==0);
 	}
+	int grid=read_option("doping_grid",0)!=0;
 	double f,g;
 	while(fscanf(doping,"%lf,%lf\n",&f,&g)>0) {
 		++NumLayers;
 	}
 	fclose(doping);
-	efield_x= new double[NumLayers+1];
-	efield_e=new double[NumLayers+1];
-	int i;
-	for(i=0; i<NumLayers+1; i++) {
-		efield_x[i]=0;
-		efield_e[i]=0;
+	if(grid) NumLayers--; //one layer between each pair of points
+	if(NumLayers<1) {
+		printf("Error: doping profile needs at least %d lines\n",grid ? 2 : 1);
+		printf("Press space to exit\n");
+		while((inputkey=_getch())==0);
 	}
+	allocate(NumLayers);
+	shared=0;
 	N=new double[NumLayers];
 	w=new double[NumLayers];
+	X=new double[NumLayers+1];
+	Q=new double[NumLayers+1];
+	P=new double[NumLayers+1];
+	Qmin=new double[NumLayers+1];
 	doping=fopen("doping_profile.txt","r");
 	int z;
-	for(z=0; z<NumLayers; z++) {
-		fscanf(doping,"%lf,%lf\n",&N[z],&w[z]);
+	if(grid) {
+		double x0,N0;
+		fscanf(doping,"%lf,%lf\n",&x0,&N0);
+		for(z=0; z<NumLayers; z++) {
+			fscanf(doping,"%lf,%lf\n",&f,&g);
+			N[z]=0.5*(N0+g);
+			w[z]=f-x0;
+			if(w[z]<0) printf("Error: doping grid positions must increase, line %d\n",z+2);
+			x0=f;
+			N0=g;
+		}
+	}
+	else{
+		for(z=0; z<NumLayers; z++) {
+			fscanf(doping,"%lf,%lf\n",&N[z],&w[z]);
+		}
 	}
 	fclose(doping);
 	for(z=0; z<NumLayers; z++) {
 		N[z]=N[z]*1e6;
 		w[z]=w[z]*1e-6;
 	}
+	charge();
+};
+
+//allocate declares the field profile arrays for a profile of layers layers
+//PRIVATE
+void device::allocate(int layers){
+	delete[] efield_x;
+	delete[] efield_e;
+	delete[] slope;
+	NumLayers=layers;
+	efield_x=new double[NumLayers+1];
+	efield_e=new double[NumLayers+1];
+	slope=new double[NumLayers+1];
+	int i;
+	for(i=0; i<NumLayers+1; i++) {
+		efield_x[i]=0;
+		efield_e[i]=0;
+		slope[i]=0;
+	}
+};
+
+//charge sums the doping over the profile. The field at x is q/die times the charge between the depletion
+//edge and x, so with Q and its integral P at every layer boundary the field and voltage of any depletion
+//region follow without going through the layers again. Q and P are taken from the boundary where the field
+//peaks to keep them small around the depletion region.
+//PRIVATE
+void device::charge(){
+	int i;
+	sign=1;
+	for(i=0; i<NumLayers; i++) {
+		if(N[i]!=0) {
+			sign=(N[i]>0) ? 1 : -1;
+			break;
+		}
+	}
+	X[0]=0;
+	Q[0]=0;
+	peak=0;
+	for(i=0; i<NumLayers; i++) {
+		X[i+1]=X[i]+w[i];
+		Q[i+1]=Q[i]+sign*N[i]*w[i];
+		if(Q[i+1]>Q[peak]) peak=i+1;
+	}
+	double Qpeak=Q[peak];
+	for(i=0; i<NumLayers+1; i++) Q[i]=Q[i]-Qpeak;
+	P[peak]=0;
+	Qmin[peak]=0;
+	for(i=peak; i<NumLayers; i++) {
+		P[i+1]=P[i]+0.5*(Q[i]+Q[i+1])*w[i];
+		Qmin[i+1]=(Q[i+1]<Qmin[i]) ? Q[i+1] : Qmin[i];
+	}
+	for(i=peak; i>0; i--) {
+		P[i-1]=P[i]-0.5*(Q[i-1]+Q[i])*w[i-1];
+		Qmin[i-1]=(Q[i-1]<Qmin[i]) ? Q[i-1] : Qmin[i];
+	}
+};
+
+//depletion finds the edges a and b of the depletion region either side of the peak where the charge falls
+//to c (c<=0), they lie in layers left and right-1. Qmin only falls moving away from the peak so the edges are
+//binary searches. Returns the voltage across the region, or -1 if it reaches either end of the profile.
+//PRIVATE
+double device::depletion(double c, int *left, int *right, double *a, double *b){
+	if(Qmin[0]>c || Qmin[NumLayers]>c) return -1;
+	int lo=0, hi=peak, mid; //Qmin[lo]<=c<Qmin[hi], or lo==hi==peak when c is 0
+	while(hi-lo>1) {
+		mid=(lo+hi)/2;
+		if(Qmin[mid]<=c) lo=mid; else hi=mid;
+	}
+	*left=lo;
+	*a=(lo<peak) ? X[lo]+w[lo]*(c-Q[lo])/(Q[lo+1]-Q[lo]) : X[peak];
+	lo=peak;
+	hi=NumLayers; //Qmin[lo]>c>=Qmin[hi]
+	while(hi-lo>1) {
+		mid=(lo+hi)/2;
+		if(Qmin[mid]<=c) hi=mid; else lo=mid;
+	}
+	if(c==0) hi=peak;
+	*right=hi;
+	*b=(hi>peak) ? X[hi-1]+w[hi-1]*(Q[hi-1]-c)/(Q[hi-1]-Q[hi]) : X[peak];
+	//P at a position s into layer i is P[i]+Q[i]*s+N*s^2/2, with N the slope of Q
+	double s=*a-X[*left];
+	double Pa=P[*left]+Q[*left]*s+0.5*sign*N[*left]*s*s;
+	s=*b-X[hi-1];
+	double Pb=(hi>peak) ? P[hi-1]+Q[hi-1]*s+0.5*sign*N[hi-1]*s*s : P[peak];
+	return q/die*(Pb-Pa-c*(*b-*a));
+};
+
+//level is the N_Layer electric field solver. Finds the charge c either side of the peak field whose depletion
+//region has voltage+Vbi across it, the field is then zero at both edges. Newton steps from guess, dV/dc is
+//-q/die*(b-a) as the field is zero at the moving edges. V is convex in c so the steps close in from below,
+//a step outside the bracket halves it instead. guess=1 starts from the widest depletion region.
+//PRIVATE
+double device::level(double voltage, double guess){
+	voltage=voltage+Vbi;
+	int left,right;
+	double a,b;
+	double clow=(Qmin[0]>Qmin[NumLayers]) ? Qmin[0] : Qmin[NumLayers]; //deepest charge before reaching an end
+	double chigh=0;
+	if (depletion(clow,&left,&right,&a,&b)<voltage) {
+		printf("ERROR, depletion region reaches the end of the doping profile\n");
+		return clow;
+	}
+	double c=(guess>clow && guess<chigh) ? guess : clow;
+	int iter;
+	for(iter=0; iter<100; iter++) {
+		double Vsum=depletion(c,&left,&right,&a,&b);
+		if (fabs(Vsum-voltage)<1e-9) break;
+		if (Vsum>voltage) clow=c; else chigh=c;
+		double next=(b>a) ? c+(Vsum-voltage)/(q/die*(b-a)) : clow;
+		if (!(next>clow && next<chigh)) next=0.5*(clow+chigh);
+		c=next;
+	}
+	return c;
 };
-//profiler is the N_Layer electric field solver. Calculates field for voltagein as a
-//N-I-P but is required as P-I-N so is then flipped and shifted so the first xposition is 0.
+
+//profiler calculates the field profile for the applied voltagein, from the field cache or starting from the
+//previous profile. The profile is P-I-N, the first xposition is the start of the doping profile.
 //PUBLIC
 void device::profiler(double voltagein){
-	double voltage;
-	voltage=voltagein+Vbi;
-	int i,j;
-	int pn=depletionlookup()+1;
-	double Vsum=0;
-	int err=0;
-	double xold=0;
-	double xoldest=0;
-	int endpoint,depleted;
-	double ereg;
-	while (Vsum<voltage) {
-		if (err==0) {
-			if (pn>0) {
-				pn=pn-1;
-			}
-			else {
-				printf("ERROR, stepped back outside 1st region\n");
-			}
-		}
-		for(i=0; i<(NumLayers+1); i++) {
-			efield_x[i]=0;
-			efield_e[i]=0;
-		}
-		if (err==0) {
-			efield_x[pn+1]=w[pn];
-		} else {
-			efield_x[pn+1]=xold;
-		}
-		efield_e[pn+1]=efield_x[pn+1]*q*N[pn]/die;
-		j=pn+1;
-		depleted=0;
-		err=0;
-		while (depleted==0 && err==0) {
-			ereg=efield_e[j]+q*N[j]*w[j]/die;
-			if (ereg*efield_e[j]>0) {
-				efield_e[j+1]=ereg;
-				efield_x[j+1]=efield_x[j]+w[j];
-				j++;
-				if (j>NumLayers-1) {
-					err=1;
-					xold=efield_x[pn+1]/2;
-				}
-			}
-			else{
-				efield_e[j+1]=0;
-				efield_x[j+1]=efield_x[j]+fabs((0-efield_e[j])/((efield_e[j]-ereg)/w[j]));
-				depleted=1;
-			}
-		}
+	if(usecache && load_field(voltagein,0)) return;
+	if(N==NULL) read();
+	last=level(voltagein,last);
+	Input_level(last);
+	if(usecache) write_field(voltagein);
+};
 
-		if (err==0) {
-			Vsum=0;
-			for(i=0; i<NumLayers; i++) {
-				Vsum=Vsum+fabs(0.5*(efield_x[i+1]-efield_x[i])*(efield_e[i]+efield_e[i+1]));
-				//Vsum=fabs(Vsum);
-				//printf("%g\n",Vsum);
-			}
-		}
-		else{
-			Vsum=0;
-		}
+//solve finds the field solutions of n biases for Input_bias. Biases in the field cache are loaded when they
+//are used, the doping profile is only read if any are missing. The rest are solved in blocks of 16 in
+//parallel, each bias starting from the one before it in its block, so the levels do not depend on the
+//number of threads.
+//PUBLIC
+void device::solve(const double *voltage, int n){
+	delete[] bias_v;
+	delete[] bias_c;
+	delete[] bias_cached;
+	nbias=n;
+	bias_v=new double[n];
+	bias_c=new double[n];
+	bias_cached=new int[n];
+	int i,missing=0;
+	for(i=0; i<n; i++) {
+		bias_v[i]=voltage[i];
+		bias_c[i]=1;
+		bias_cached[i]=usecache && load_field(voltage[i],1);
+		if(!bias_cached[i]) missing++;
 	}
-	int solve=0;
-	int firstloop=0;
-	double xtest=efield_x[pn+1];
-	while (solve==0) {
-		for(i=0; i<(NumLayers+1); i++) {
-			efield_x[i]=0;
-			efield_e[i]=0;
-		}
-		if (Vsum>voltage) {
-			if (firstloop==0) {
-				xold=xtest;
-				xtest=xtest/2.0;
-				firstloop=1;
-			} else {
-				xoldest=xold;
-				xold=xtest;
-				xtest=xold-fabs((xoldest-xold)/2);
-			}
-		} else {
-			if (firstloop==0) {
-				xold=xtest;
-				xtest=3*xtest/2.0;
-				firstloop=1;
-			} else {
-				xoldest=xold;
-				xold=xtest;
-				xtest=xold+fabs((xoldest-xold)/2);
-			}
-		}
-		efield_x[pn+1]=xtest;
-		efield_e[pn+1]=xtest*q*N[pn]/die;
-		int j=pn+1;
-		depleted=0;
-		while (depleted==0) {
-			ereg=efield_e[j]+q*N[j]*w[j]/die;
-			if (ereg*efield_e[j]>0) {
-				efield_e[j+1]=ereg;
-				efield_x[j+1]=efield_x[j]+w[j];
-				j++;
-				if (j>NumLayers) {
-					printf("Error in field solver\n");
-				}
-			}
-			else{
-				efield_e[j+1]=0;
-				efield_x[j+1]=efield_x[j]+fabs((0-efield_e[j])/((efield_e[j]-ereg)/w[j]));
-				depleted=1;
-				endpoint=j+1;
-			}
-		}
-		Vsum=0;
-		for(i=0; i<NumLayers; i++) {
-			Vsum=Vsum+fabs(0.5*(efield_x[i+1]-efield_x[i])*(efield_e[i]+efield_e[i+1]));
-			//Vsum=fabs(Vsum);
-		}
-		if (fabs(Vsum-voltage)<0.00001) {
-			solve=1;
-			//printf("I Solve\n");
+	if(missing==0) return;
+	if(N==NULL) read();
+	int blocks=(n+15)/16;
+	int k;
+	#pragma omp parallel for schedule(dynamic)
+	for(k=0; k<blocks; k++) {
+		double guess=1;
+		for(int j=16*k; j<n && j<16*(k+1); j++) {
+			if(bias_cached[j]) continue;
+			guess=level(voltage[j],guess);
+			bias_c[j]=guess;
 		}
 	}
+};
 
-	efield_x[pn]=0-efield_x[pn+1];
-	for(i=pn+1; i<NumLayers+1; i++) {
-		efield_x[i]=efield_x[i]+efield_x[pn];
+//Input_bias sets the field profile to bias i of solve(), adding it to the field cache if it was solved.
+//PUBLIC
+void device::Input_bias(int i){
+	if(bias_cached[i]) {
+		if(load_field(bias_v[i],0)) return;
+		//the cache file has gone since solve()
+		if(N==NULL) read();
+		bias_c[i]=level(bias_v[i],last);
 	}
-	for(i=0; i<pn+1; i++) {
-		for(j=0; j<NumLayers+1; j++) {
-			efield_x[j]=efield_x[j]+w[i];
-		}
+	Input_level(bias_c[i]);
+	if(usecache) write_field(bias_v[i]);
+};
+
+//Input_level fills in the field profile of the depletion region at charge level c.
+//PUBLIC
+void device::Input_level(double c){
+	int i,left,right;
+	double a,b;
+	depletion(c,&left,&right,&a,&b);
+	for(i=0; i<NumLayers+1; i++) {
+		efield_x[i]=(i<=left) ? a : (i>=right) ? b : X[i];
+		efield_e[i]=(i<=left || i>=right) ? 0 : sign*q/die*(Q[i]-c);
 	}
-	for(i=pn-1; i>-1; i--) {
-		efield_x[i]=efield_x[pn];
+	i_min=left;
+	i_max=right;
+	last=c;
+	lookup();
+};
+
+//lookup sets up the segment gradients and the uniform cells used by Efield_at_x, four cells per segment
+//PRIVATE
+void device::lookup(){
+	int i, c;
+	for(i=i_min; i<i_max; i++) {
+		double dx=efield_x[i+1]-efield_x[i];
+		slope[i]=(dx>0) ? (efield_e[i+1]-efield_e[i])/dx : 0;
 	}
-	for(i=endpoint+1; i<NumLayers+1; i++) {
-		efield_x[i]=efield_x[endpoint];
+	delete[] cell_segment;
+	cells=4*(i_max-i_min);
+	if(cells<1) cells=1;
+	cell_segment=new int[cells];
+	cell_scale=cells/(efield_x[i_max]-efield_x[i_min]);
+	i=i_min;
+	for(c=0; c<cells; c++) {
+		double xc=efield_x[i_min]+c/cell_scale;
+		//last segment starting strictly before the cell, so a position rounded into the cell can't be behind it
+		while(i+1<i_max && efield_x[i+1]<xc) i++;
+		cell_segment[c]=i;
 	}
-	i_min=pn;
-	i_max=endpoint;
+};
 
+//Field cache key of a bias, from the hash of doping_profile.txt and the material. Solved profiles are kept in
+//field_<key>.bin files so later runs map them instead of reading the doping profile and solving.
+//PRIVATE
+uint64_t device::field_key(double voltage){
+	return hash_double(voltage,doping_key);
 };
-//depletionlookup finds the pn junction
-int device::depletionlookup(){
+
+//load_field reads the field profile of voltage from the field cache, with check set it only tests that the
+//profile is there. Returns 0 if it is missing or doesn't match.
+//PRIVATE
+int device::load_field(double voltage, int check){
+	char filename[300];
+	uint64_t key=field_key(voltage);
+	cache_filename("field",key,filename,sizeof(filename));
+	mapped_file map;
+	if(!map_file(filename,&map)) return 0;
+	const field_header *header=(const field_header *)map.data;
+	int ok=(map.size>=sizeof(field_header) && strcmp(header->magic,"SMCEF")==0 && header->version==FIELD_VERSION
+	        && header->key==key && header->voltage==voltage && (N==NULL || header->layers==NumLayers));
+	size_t n=0;
+	if(ok) {
+		n=header->i_max-header->i_min+1;
+		ok=(header->i_min>=0 && header->i_max<=header->layers && n>1 && header->cells>0
+		    && map.size==sizeof(field_header)+(3*n-1)*sizeof(double)+header->cells*sizeof(int));
+	}
+	if(!ok || check) {
+		unmap_file(&map);
+		return ok;
+	}
+	if(efield_x==NULL || header->layers!=NumLayers) allocate(header->layers);
+	i_min=header->i_min;
+	i_max=header->i_max;
+	const double *data=(const double *)(header+1);
 	int i;
-	for(i=0; i<(NumLayers-1); i++) {
-		double x;
-		x=N[i]*N[i+1];
-		if(x<=0) {
-			return i;
-		}
+	for(i=0; i<NumLayers+1; i++) {
+		efield_x[i]=(i<=i_min) ? data[0] : (i>=i_max) ? data[n-1] : data[i-i_min];
+		efield_e[i]=(i<=i_min || i>=i_max) ? 0 : data[n+i-i_min];
 	}
-	return 0;
+	memcpy(slope+i_min,data+2*n,(n-1)*sizeof(double));
+	delete[] cell_segment;
+	cells=header->cells;
+	cell_scale=header->cell_scale;
+	cell_segment=new int[cells];
+	memcpy(cell_segment,data+3*n-1,cells*sizeof(int));
+	last=header->level;
+	unmap_file(&map);
+	return 1;
+};
+
+//write_field adds the current field profile, the profile of voltage, to the field cache
+//PRIVATE
+void device::write_field(double voltage){
+	field_header header;
+	memset(&header,0,sizeof(header));
+	strcpy(header.magic,"SMCEF");
+	header.version=FIELD_VERSION;
+	header.layers=NumLayers;
+	header.i_min=i_min;
+	header.i_max=i_max;
+	header.cells=cells;
+	header.key=field_key(voltage);
+	header.cell_scale=cell_scale;
+	header.voltage=voltage;
+	header.level=last;
+	size_t n=i_max-i_min+1;
+	size_t size=(3*n-1)*sizeof(double)+cells*sizeof(int);
+	double *data=new double[(size+sizeof(double)-1)/sizeof(double)];
+	memcpy(data,efield_x+i_min,n*sizeof(double));
+	memcpy(data+n,efield_e+i_min,n*sizeof(double));
+	memcpy(data+2*n,slope+i_min,(n-1)*sizeof(double));
+	memcpy(data+3*n-1,cell_segment,cells*sizeof(int));
+	char filename[300];
+	cache_filename("field",header.key,filename,sizeof(filename));
+	if(!write_cache(filename,&header,sizeof(header),data,size))
+		printf("Could not write field cache \"%s\"\n",filename);
+	delete[] data;
 };
@@ -21,7 +21,7 @@
    Reads in applied biasses from the user generated file bias_input.txt
    Uses the read in device structure from the user generated file doping_profile.txt contained in the device class.
 
-   Uses the Classes SMC, Carrier, Device & tools.
+   Uses the Classes SMC, Device, tools, trial & bias_point, the trials of all the biases are spread over the threads.
    Also uses functions.h which contains common functions used in all three modes.
    Also uses dev_prop_func.h which contains functions unique to the device properties mode.
 
@@ -38,7 +38,8 @@
 #include "functions.h"
 #include "dev_prop_func.h"
 #include "tools.h"
-#include "carrier.h"
+#include "trial.h"
+#include "bias_point.h"
 #include <stdio.h>
 #include <tchar.h>
 #include <math.h>
@@ -46,7 +47,122 @@
 #include <iostream>
 #include <string.h>
 #include <fstream>
-
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <time.h>
+#define omp_get_wtime() ((double)clock()/CLOCKS_PER_SEC)
+typedef int omp_lock_t; //a single thread never waits on a lock
+#define omp_init_lock(l) ((void)(l))
+#define omp_destroy_lock(l) ((void)(l))
+#define omp_set_lock(l) ((void)(l))
+#define omp_unset_lock(l) ((void)(l))
+#endif
+
+//Writes the biases that are done to Result_1.txt in the order of bias_input.txt. Each is taken off point under the
+//scheduler's lock and written outside it, writing keeps the next one back until it is finished.
+//Not called under the scheduler's lock.
+static void write_done(bias_point **point, int bias_count, int *written, int *writing, FILE *out, FILE *errors){
+	while(1) {
+		bias_point *b=NULL;
+		#pragma omp critical(schedule)
+		{
+			if(!*writing && *written<bias_count && point[*written]!=NULL && point[*written]->Get_done()) {
+				b=point[*written];
+				point[*written]=NULL;
+				*writing=1;
+			}
+		}
+		if(b==NULL) return;
+		b->finish(out,errors);
+		delete b;
+		#pragma omp critical(schedule)
+		{
+			(*written)++;
+			*writing=0;
+		}
+	}
+};
+
+//Estimated seconds per trial of bias i, measured once its chunks have run, otherwise taken from the measured bias
+//nearest in voltage, or the voltage itself before anything is measured so higher biases come first
+static double estimate(bias_point **point, double *V, int bias_count, int i){
+	int j;
+	double cost=V[i];
+	double nearest=HUGE_VAL;
+	for(j=0; j<bias_count; j++) {
+		if(point[j]!=NULL && point[j]->costed>0 && fabs(V[j]-V[i])<nearest) {
+			nearest=fabs(V[j]-V[i]);
+			cost=point[j]->cost/point[j]->costed;
+		}
+	}
+	return cost;
+};
+
+//Returns the started bias with the most estimated seconds in the chunks it may still hand out, -1 if none,
+//called under the scheduler's lock
+static int pick(bias_point **point, double *V, int bias_count){
+	int i,best=-1;
+	double most=0;
+	for(i=0; i<bias_count; i++) {
+		if(point[i]==NULL || point[i]->stopped || point[i]->dispatched>=point[i]->allowed) continue;
+		double left=(point[i]->allowed-point[i]->dispatched)*estimate(point,V,bias_count,i);
+		if(best<0 || left>most) {
+			most=left;
+			best=i;
+		}
+	}
+	return best;
+};
+
+//Shares the next round of a sweep budget out over the biases, every chunk of the last round having been added.
+//Each chunk goes to the bias with the largest error, taking the square of the error of a bias to fall as one over
+//its trials, so the errors are brought down together. A round gives out about half of the budget left, in trials
+//or in the estimated seconds of the chunks, so later rounds follow the results of the earlier ones. Returns the chunks given out, 0 once the
+//budget is spent or every bias has run all its trials or met its targets.
+static int allocate(bias_point **point, double *V, int bias_count, double budget_trials, double budget_seconds, double spent_trials, double spent_seconds){
+	double left_trials=(budget_trials>0) ? budget_trials-spent_trials : HUGE_VAL;
+	double left_seconds=(budget_seconds>0) ? budget_seconds-spent_seconds : HUGE_VAL;
+	if(left_trials<BIAS_CHUNK || left_seconds<=0) return 0;
+	double round_trials=_max(left_trials/2,BIAS_CHUNK);
+	double round_seconds=left_seconds/2;
+	double *var=new double[bias_count]; //squared error times trials, taken not to change as trials are added
+	double *n=new double[bias_count];  //trials run and given out
+	double *cost=new double[bias_count]; //seconds per trial
+	int i;
+	for(i=0; i<bias_count; i++) {
+		if(point[i]==NULL) continue;
+		var[i]=point[i]->error()*point[i]->error()*point[i]->Get_trials();
+		n[i]=point[i]->Get_trials();
+		cost[i]=estimate(point,V,bias_count,i);
+	}
+	int given=0;
+	double trials=0, seconds=0;
+	while(1) {
+		int best=-1;
+		double most=0;
+		for(i=0; i<bias_count; i++) {
+			if(point[i]==NULL || point[i]->stopped || point[i]->allowed>=point[i]->Get_chunks()) continue;
+			double error=var[i]/n[i];
+			if(best<0 || error>most) {
+				most=error;
+				best=i;
+			}
+		}
+		if(best<0) break;
+		//the first chunk of a round is given out even if a time budget is nearly spent
+		if(given>0 && (trials+BIAS_CHUNK>round_trials || seconds+BIAS_CHUNK*cost[best]>round_seconds)) break;
+		point[best]->allowed++;
+		n[best]+=BIAS_CHUNK;
+		trials+=BIAS_CHUNK;
+		seconds+=BIAS_CHUNK*cost[best];
+		given++;
+	}
+	delete[] var;
+	delete[] n;
+	delete[] cost;
+	return given;
+};
 
 
 
@@ -59,8 +175,7 @@ void device_properties(int material){
 	if(material == 1) fprintf(userin,"Silicon\n");
 	else if(material == 2) fprintf(userin,"Gallium Arsenide\n");
 	else if(material ==3) fprintf(userin,"Indium Gallium Phosphide\n");
-	int timearray, Highest;
-	double cumulative, voltage;
+	double voltage;
 	SMC constants; //SMC parameter set
 	constants.mat(material); // tell constants what material to use
 	SMC *pointSMC = &constants; //Used to pass constants to other classes.
@@ -85,6 +200,7 @@ void device_properties(int material){
 		bias_count++;
 	}
 	fclose(bias);
+	diode.solve(V,bias_count); //field solutions of every bias, from the field cache where possible
 
 	int timeslice = timesliceread();
 	fprintf(userin,"Divisions Per Transit time: %d\n", timeslice);
@@ -98,544 +214,175 @@ void device_properties(int material){
 	fclose(userin);
 	tools simulation(pointSMC);
 	simulation.scattering_probability();//this function returns 0 if no output can be generated and the user wants to quit
-	sgenrand(835800);//seeds the random number generator constant used to alow for comparison using different parameters.
-	int num;
-	double Efield,npha,nph,nphe,nii,nsse,Energy,z_pos,dE,kf,kxy,kz,nssh;
-	double drift_t;
-
-	// create electron and hole classes, too large for stack so have been created with new.
-	carrier* electron=new carrier(pointSMC);
-	carrier* hole=new carrier(pointSMC);
+	//population_limit in smc_options.txt turns on merging of carriers into weighted carriers when more than
+	//this number of electrons or holes are in the diode, 0 (default) tracks every carrier
+	int population=(int)read_option("population_limit",0);
+	//parallel_carriers is the number of carriers due in one pass of a trial before they are stepped in parallel
+	//chunks, 0 keeps every pass on the thread running the trial
+	int parallel_carriers=(int)read_option("parallel_carriers",4096);
+	//target_M, target_F and target_Pb in smc_options.txt stop a bias once the 95% intervals of M and F relative to
+	//their values, and of Pb, are that narrow, after at least min_trials trials. The number of trials is the most run.
+	stopping targets;
+	targets.M=read_option("target_M",0);
+	targets.F=read_option("target_F",0);
+	targets.Pb=read_option("target_Pb",0);
+	targets.min_trials=(int)read_option("min_trials",100);
+	const stopping *rule=(targets.M>0 || targets.F>0 || targets.Pb>0) ? &targets : NULL;
+	//budget_trials and budget_seconds share a total number of trials, or core-seconds of running trials, over the
+	//sweep. Each bias first runs min_trials, the rest goes to the biases with the largest errors.
+	double budget_trials=read_option("budget_trials",0);
+	double budget_seconds=read_option("budget_seconds",0);
+	int budget=(budget_trials>0 || budget_seconds>0);
+	int pilot=(targets.min_trials+BIAS_CHUNK-1)/BIAS_CHUNK; //chunks each bias runs before the budget is shared out
+	if(pilot<2) pilot=2;
+	FILE *errors=NULL;
+	if(budget) {
+		if ((errors=fopen("Result_3.txt","w"))==NULL)//Opens and error checks
+		{   printf("Error: Result_3.txt can't open\n");}
+		else fprintf(errors,"Voltage Trials dM dF dPb\n");
+	}
 
-	//double* ITotalCurrent = new double[100]; //hold all the current data per all the trials
-	
-	double breakdown, Pbreakdown, Vsim;
 	/**** BEGIN SIMULATION LOOP VOLTAGE ****/
-	int bias_array=0;
-	printf("%d %d \n", bias_count, bias_array);
-	for(bias_array=0; bias_array<bias_count; bias_array++)
-	{
-		Vsim=V[bias_array];
-
-		diode.profiler(Vsim);//generates field profile for diode
-		printf("Width = %e \n", diode.Get_width());
-		double timestep=diode.Get_width()/((double)timeslice*1e5); //Time tracking step size in seconds
-		printf("timestep = %e \n", timestep);
-
-		int CurrentArray=(int)(simulationtime/timestep); // calculates number of timesteps required for simulationtime
-		
-		double cutofftime=(CurrentArray-5)*timestep; // prevents overflow
-		int cutoff =0;
-
-		double* ITotalCurrent=new double[10*CurrentArray]; //hold all the current data per all the trials
-		
-		std::cout << "size of ITotalCurrent array:" << sizeof(ITotalCurrent) << std::endl;
-		double* I=new double[CurrentArray];
-		double* Inum=new double[CurrentArray];
-		
-		int Iarray;
-		for (Iarray=0; Iarray<CurrentArray; Iarray++) {
-			I[Iarray]=0;
-		}
-		//generate files for simulated voltage output.
-		FILE *tbout;
-		FILE *Mout;
-		char nametb[] = "time_to_breakdown.txt";
-		char nameM[]= "gain_out.txt";
-		char voltagetb[8];
-		snprintf(voltagetb,sizeof(voltagetb),"%g",Vsim);
-		int filetb_len = strlen(voltagetb) + strlen(nametb) + 1;
-		char *filetb = new char[filetb_len];
-		snprintf(filetb,filetb_len,"%s%s",voltagetb,nametb);
-		if ((tbout=fopen(filetb,"w"))==NULL)
-		{
-			printf("Error: tbout can't be opened'\n");
-		}
-		delete[] filetb;
-		int fileM_len = strlen(voltagetb) + strlen(nameM) + 1;
-		char *fileM = new char[fileM_len];
-		snprintf(fileM,fileM_len,"%s%s",voltagetb,nameM);
-		if ((Mout=fopen(fileM,"w"))==NULL)
-		{
-			printf("Error: gain out can't be opened'\n");
-
-		}
-		delete[] fileM;
-		char namecounter[] = "eventcounter.txt";
-		FILE *counter;
-		int countname_len = strlen(namecounter) + strlen(voltagetb) + 1;
-		char *countname = new char[countname_len];
-		snprintf(countname,countname_len,"%s%s",voltagetb,namecounter);
-		if((counter=fopen(countname,"w"))==NULL) {
-			printf("Error: Can't open counter dump file \n'");
-
-		}
-		delete[] countname;
-		Highest=0;
-		cumulative=0;
-
-		breakdown=0;
-		double gain,Ms,F,tn,time;
-		double dt,dx;
-		Ms=0;
-		F=0;
-		gain=0;
-		double globaltime=0;
-		int num_electron,num_hole,prescent_carriers, pair;
-		
-
-
-		//write the current in the device per trail
-		//std::ofstream fp_transient_current;
-		//std::string fname_transient_current("transient_current");
-		//fp_transient_current.open(fname_transient_current);
-		
-		/**** BEGIN SIMULATION LOOP TRIALS****/
-		for(num=1; num<=Ntrials; num++)
+	//The biases are split into chunks of trials that any thread can run. The most expensive bias left is started
+	//whenever every chunk of the biases already started has been handed out, so the slow biases near breakdown
+	//don't leave a long tail at the end. A bias's cost per trial is measured as its chunks run, the biases not
+	//started yet are estimated from the measured bias nearest in voltage, or taken to grow with voltage before
+	//any are measured. The results of each bias are added in trial order and written in bias order. A bias is
+	//claimed under the scheduler's lock but set up and written outside it, so other threads keep running trials.
+	//A bias that meets its stopping targets hands out no more chunks.
+	//Under a budget the sweep runs in rounds, each bias only hands out the chunks it has been allowed. The first
+	//round runs the first chunks of every bias, between rounds allocate() gives the next ones to the biases with
+	//the largest errors. As the rounds are shared out from the added trials only, a trial budget gives the same
+	//results for any number of threads.
+	bias_point **point=new bias_point*[bias_count];
+	int *started=new int[bias_count];
+	int *setting=new int[bias_count];         //1 while a thread sets the bias up
+	omp_lock_t *setup=new omp_lock_t[bias_count]; //held by that thread, threads with nothing to do wait on it
+	int bias_array;
+	for(bias_array=0; bias_array<bias_count; bias_array++) {
+		point[bias_array]=NULL;
+		started[bias_array]=0;
+		setting[bias_array]=0;
+		omp_init_lock(&setup[bias_array]);
+	}
+	int open=0;     //biases started
+	int written=0;  //biases written to Result_1.txt
+	int writing=0;  //1 while a thread writes bias written
+	int next=-1;    //started bias with chunks left to hand out, -1 if none
+	double spent_trials=0, spent_seconds=0;
+	int round=1;
+	while(round) {
+		#pragma omp parallel
 		{
-			for (Iarray=0; Iarray<CurrentArray; Iarray++) {
-				Inum[Iarray]=0;
-			}
-			num_electron=1;
-			num_hole=1;
-			tn=1;
-			prescent_carriers=2;
-			kf=0;
-			kxy=0;
-			kz=0;
-			dE=0;
-			Energy=0;
-			z_pos=0;
-			drift_t=0;
-			time=0;
-			dt=0;
-			dx=0;
-			nph=0;//total phonon interactions
-			npha=0;//photon absorption counter
-			nphe=0;//photon emission counter
-			nii=0;//impact ionization event counter
-			nsse=0;//scattering event counter
-			nssh=0;
-			int cut2=0;
-			globaltime=timestep;
-
-
-			/* Device 1-PIN
-			   Device 2-NIP*/
-
-			if (usDevice==1) {
-				electron->Input_pos(1,diode.Get_xmin()+1e-10);
-				hole->Input_pos(1,-1);
-				prescent_carriers=1;
-			}
-			if (usDevice==2) {
-				electron->Input_pos(1,(diode.Get_xmax()+1e-10));
-				hole->Input_pos(1,(diode.Get_xmax()-1e-10));
-				prescent_carriers=1;
-			}
-			//carrierlimit is a threshold to end the simulation early  - RAMO's theorm
-			double carrierlimit=BreakdownCurrent*diode.Get_width()/(5*constants.Get_q()*1e5);
-
-			/****TRACKS CARRIERS WHILE IN DIODE****/
-			while(prescent_carriers>0 && cut2==0)
-			{ /****LOOPS OVER ALL PAIRS ****/
-				for(pair=1; pair<=num_electron; pair++)
+			//each thread creates its own trial engine with its own electron and hole classes and random number generator
+			trial *engine=new trial(pointSMC,&simulation,usDevice,population,parallel_carriers);
+			while(1) {
+				bias_point *b=NULL;
+				int c=0;
+				int build=-1;  //bias to set up
+				int wait=-1;   //bias being set up that may have chunks for this thread
+				#pragma omp critical(schedule)
 				{
-					int flag=0;
-					// ELECTRON PROCESS
-					z_pos=electron->Get_pos(pair);
-					time=electron->Get_time(pair);
-					dt=electron->Get_dt(pair);
-					dx=electron->Get_dx(pair);
-					if(z_pos<diode.Get_xmin()) z_pos=diode.Get_xmin()+1e-10; // resets a bad trial where the electron drifted out the device the wrong way (extremly rare but causes program to hang)
-
-					//If flag stays 0 for all the devices it means that there are no carriers behind globaltime and globaltime can be advanced
-					//Doing this limits the program to only be simulating the carriers in the same timebin at the same time (Important for calculating instentanious current)
-					if(z_pos<diode.Get_xmax() && time<globaltime)//checks inside field
-					{    flag++;//used to advance globaltime
-						 Energy=electron->Get_Egy(pair);
-						 if((electron->Get_scattering(pair)==0))//if not selfscattering scatters in random direction
-						 {   electron->scatter(pair,0);}
-
-						 kxy=electron->Get_kxy(pair);
-						 kz=electron->Get_kz(pair);
-
-						//electron drift process starts
-						//drifts for a random time
-						 double random1;
-						 random1=genrand();
-						 drift_t= -log(random1)/(simulation.Get_rtotal());
-						 time+=drift_t;
-						 dt+=drift_t;
-
-						//updates parameters based on random drift time
-						 Efield=diode.Efield_at_x(z_pos);
-						 kz+=(constants.Get_q()*drift_t*Efield)/(constants.Get_hbar());
-						 dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz)-Energy;
-						 Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz);
-						 z_pos+=dE/(constants.Get_q()*Efield);
-						 dx+=dE/(constants.Get_q()*Efield);
-						 if(time>cutofftime) {
-							 //cuts off electron and removes it from device if user spec. timelimit exceeded
-							 z_pos=diode.Get_xmax()+10;
-							 cutoff=1;
-						 }
-						 if(dt>=timestep) {
-							 //calc current  if time since last calculated  >timestep
-							 timearray=(int)floor(time/timestep);
-							 int previous;
-							 previous=electron->Get_timearray(pair);
-							 int test;
-							 for(test=(previous+1); test<(timearray+1); test++) {
-								 //Uses Ramos Theorem Here
-								 I[test]+=constants.Get_q()*dx/(dt*diode.Get_width());
-								 Inum[test]+=constants.Get_q()*dx/(dt*diode.Get_width());
-							 }
-							 electron->Input_timearray(pair,timearray);
-							 dt=0;
-							 dx=0;
-						 }
-						 electron->Input_time(pair,time);
-						 electron->Input_dt(pair,dt);
-						 electron->Input_dx(pair,dx);
-
-						//electron drift process ends
-
-						//update electron position and energy
-						 electron->Input_pos(pair,z_pos);
-						 electron->Input_Egy(pair,Energy);
-
-						//electron scattering
-						 if(z_pos<0) z_pos=1e-10;
-						 if((z_pos<=diode.Get_xmax()))
-						 { //electron scattering process starts
-							 double random2;
-							 int Eint;
-							 Eint=(int)floor(Energy*1000.0/constants.Get_q()+0.5);
-							 if (Energy>constants.Get_Emax())
-							 {    Eint= constants.Get_NUMPOINTS();
-							  random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());}
-							 else if (Energy == constants.Get_Emax()) random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());
-							 else{
-								 random2=genrand();
-							 }
-
-							 if(random2<=simulation.Get_pb(0,Eint)) //phonon absorption
-							 {    Energy+=constants.Get_hw();
-							  npha++;
-							  nph++;
-							  electron->Input_scattering(pair,0);}
-							 else if(random2<=simulation.Get_pb(1,Eint)) //phonon emission
-							 {    Energy-=constants.Get_hw();
-							  nphe++;
-							  nph++;
-							  electron->Input_scattering(pair,0);}
-							 else if(random2<=simulation.Get_pb(2,Eint)) //impact ionization
-							 {
-								 Energy=(Energy-constants.Get_e_Eth())/3.0;
-								 num_electron++;
-								 electron->generation(num_electron,z_pos,Energy,time,0,(int)floor(time/timestep));
-								 num_hole++;
-								 hole->generation(num_hole,z_pos,Energy,time,0,(int)floor(time/timestep));
-								 tn++;
-								 nii++;
-								 prescent_carriers+=2;
-								 electron->Input_scattering(pair,0);
-							 }
-							 else if(random2>simulation.Get_pb(2,Eint)) //selfscattering
-							 {    nsse++;
-							  electron->Input_scattering(pair,1);
-							  electron->Input_kxy(pair,kxy);
-							  electron->Input_kz(pair,kz);}
-							 //electron scattering process ends
-
-						 }
-						 else prescent_carriers--;
-
-						 electron->Input_Egy(pair,Energy);
-						 if(time>globaltime) flag--; }
-
-					//HOLE PROCESS
-					z_pos=hole->Get_pos(pair);
-					time=hole->Get_time(pair);
-					dt=hole->Get_dt(pair);
-					dx=hole->Get_dx(pair);
-					if(z_pos>diode.Get_xmax()) z_pos=diode.Get_xmax()-1e-10;
-					if(z_pos>=diode.Get_xmin() && time<globaltime)
-					{    Energy=hole->Get_Egy(pair);
-						 flag++;
-						 if((hole->Get_scattering(pair)==0))
-						 {    hole->scatter(pair,2);}
-
-						 kxy=hole->Get_kxy(pair);
-						 kz=hole->Get_kz(pair);
-
-
-						//Hole drift starts here
-						 double random11;
-						 random11=genrand();
-						 drift_t= -log(random11)/simulation.Get_rtotal2();
-						 time+=drift_t;
-						 dt+=drift_t;
-						 Efield=diode.Efield_at_x(z_pos);
-						 kz-=((constants.Get_q()*drift_t*Efield)/(constants.Get_hbar()));
-						 dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz)-Energy;
-						 Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz);
-						 z_pos-=dE/(Efield*constants.Get_q());
-						 dx+=dE/(Efield*constants.Get_q());
-						 if(time>cutofftime) {
-							 z_pos=diode.Get_xmin()-10;
-							 cutoff=1;
-						 }
-						 if(dt>=timestep) {
-							 timearray=(int)floor(time/timestep);
-							 int previous;
-							 previous=hole->Get_timearray(pair);
-							 int test;
-							 for(test=(previous+1); test<(timearray+1); test++) {
-								 I[test]+=constants.Get_q()*dx/(dt*diode.Get_width());
-								 Inum[test]+=constants.Get_q()*dx/(dt*diode.Get_width());
-							 }
-							 dt=0;
-							 dx=0;
-							 hole->Input_timearray(pair,timearray);
-						 }
-						 hole->Input_time(pair,time);
-						 hole->Input_dt(pair,dt);
-						 hole->Input_dx(pair,dx);
-
-						//Hole drift finishes here
-						 hole->Input_pos(pair,z_pos);
-						 hole->Input_Egy(pair,Energy);
-
-
-						 if(z_pos>diode.Get_xmax()) z_pos=diode.Get_xmax()-1e-10;
-						 if(z_pos>=diode.Get_xmin())
-						 { //Hole scattering starts here
-							 double random22;
-							 int Eint2;
-							 Eint2=(int)floor(Energy*1000.0/constants.Get_q()+0.5);
-							 if (Energy>constants.Get_Emax())
-							 {    Eint2=constants.Get_NUMPOINTS();
-							  random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());}
-							 else if (Energy==constants.Get_Emax())
-							 {    random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());}
-							 else {
-								 random22=genrand();
-							 }
-
-							 if(random22<=simulation.Get_pb2(0,Eint2)) //phonon absorption
-							 {
-								 Energy+=constants.Get_hw();
-								 npha++;
-								 nph++;
-								 hole->Input_scattering(pair,0);
-							 }
-							 else if(random22<=simulation.Get_pb2(1,Eint2)) //phonon emission
-							 {
-								 Energy-=constants.Get_hw();
-								 nphe++;
-								 nph++;
-								 hole->Input_scattering(pair,0);
-							 }
-							 else if(random22<=simulation.Get_pb2(2,Eint2)) //impact ionization
-							 {
-								 Energy=(Energy-constants.Get_h_Eth())/3.0;
-								 num_electron++;
-								 electron->generation(num_electron,z_pos,Energy,time,0,(int)floor(time/timestep));
-								 num_hole++;
-								 hole->generation(num_hole,z_pos,Energy,time,0,(int)floor(time/timestep));
-								 tn++;
-								 nii++;
-								 prescent_carriers+=2;
-								 hole->Input_scattering(pair,0);
-							 }
-							 else if(random22>simulation.Get_pb2(2,Eint2)) //selfscattering
-							 {
-								 nssh++;
-								 hole->Input_scattering(pair,1);
-								 hole->Input_kxy(pair,kxy);
-								 hole->Input_kz(pair,kz);
-							 }
-							 //hole scattering ends here
-
-						 }
-						 else prescent_carriers--;
-
-						 hole->Input_Egy(pair,Energy);
-						 if(time>globaltime) flag--; }
-					Highest=(int)_max(Highest,pair);
-
-					if(flag==0) {
-						globaltime+=timestep;
-						//This is where globaltime is incrimented
-					}
-				}
-				int scan=0;
-				int scanlimit=0;
-				//scans current array to detect breakdown current and stops sim early
-				if(pair>carrierlimit) {
-					while(scan==0) {
-						for(Iarray=0; Iarray<CurrentArray; Iarray++) {
-							if(Inum[Iarray]>BreakdownCurrent) {
-								scan=1;
-								cut2=1;
+					if(next<0) next=pick(point,V,bias_count); //a bias set up by another thread, or a later round of a budget
+					if(next<0 && open<bias_count) {
+						//starts the bias with the highest estimated cost of its remaining trials
+						int i,best=-1;
+						double bestcost=-HUGE_VAL;
+						for(i=0; i<bias_count; i++) {
+							if(started[i]) continue;
+							double cost=estimate(point,V,bias_count,i);
+							if(cost>bestcost || (cost==bestcost && V[i]>V[best])) {
+								bestcost=cost;
+								best=i;
 							}
-							if(Iarray==CurrentArray-1) scan=1;
 						}
-						if(Inum[Iarray]==0) ++scanlimit;
-						if(Inum[Iarray]!=0) scanlimit=0;
-						if(scanlimit>50) scan=1;
+						started[best]=1;
+						open++;
+						setting[best]=1;
+						omp_set_lock(&setup[best]); //free, no thread has waited on it yet
+						build=best;
+					}
+					else if(next>=0) {
+						b=point[next];
+						c=b->dispatched++;
+						if(b->dispatched==b->allowed) next=-1;
+					}
+					else {
+						int i;
+						for(i=0; i<bias_count; i++) if(setting[i]) wait=i;
 					}
 				}
-			}
-			gain+=tn/Ntrials; //accumilates average gain
-			Ms+=(tn*tn/Ntrials); //accumilates average Ms, used to calculate noise
-			cumulative+=tn; //tracks average gain so far in simulation
-			double printer=cumulative/num;
-
-			//reset carrier arrays to 0 after trial
-			electron->reset();
-			hole->reset();
-			//checks for breakdown at end of sim
-			for (Iarray=0; Iarray<CurrentArray; Iarray++) {
-				if(Inum[Iarray] > BreakdownCurrent) {
-					breakdown++;
-					fflush(counter);
-					double tb = timestep*Iarray;
-					fprintf(tbout,"%d %g\n",num,tb);
-					fflush(tbout);
-					break;
+				if(build>=0) {
+					//the field profile and output files of the bias are set up outside the lock
+					bias_point *p=new bias_point(pointSMC,&diode,build,V[build],timeslice,simulationtime,(int)Ntrials,BreakdownCurrent,rule);
+					if(budget && pilot<p->Get_chunks()) p->allowed=pilot;
+					#pragma omp critical(schedule)
+					{
+						point[build]=p;
+						setting[build]=0;
+						if(next<0) next=build;
+					}
+					omp_unset_lock(&setup[build]);
+					continue;
 				}
-			}
-
-			//trapezium rule
-			int arealimitnum=0;
-			double totalareanum=0;
-			double area,x1,x2,y1,y2;
-			int i;
-			for(i=0; i<(CurrentArray-1); i++)
-			{
-				y1=Inum[i];
-				x1=timestep*i;
-				y2=Inum[i+1];
-				x2=timestep*(i+1);
-				area=y1*(x2-x1)+0.5*(y2-y1)*(x2-x1);
-				totalareanum+=area;
-			}
-			totalareanum=totalareanum/1.6e-19;
-			fprintf(Mout, "%d %g %g\n",num, totalareanum, tn);
-			fflush(Mout);
-			double Pbprint=breakdown/num;
-			if(!(num%100)) {
-				if(cutoff==0) printf("Completed trial: %d Gain=%f Pb=%f . Max array index=%d\n",num,printer,Pbprint,Highest);
-				if(cutoff==1) printf("Completed trial: %d Cutoff Pb=%f  Max array index=%d\n",num,Pbprint,Highest);
-			}
-		
-			///PLOT THE Inum array. This gives the time vs. Current per trail.
-			if (num<10)
-			{
-				for(int i=0; i<(CurrentArray-1); i++)
-				{
-					//std::cout << num << std::endl;;
-					//std::cout << i << std::endl;
-					ITotalCurrent[num*CurrentArray+i] = Inum[i];
-					//std::cout << Inum[i] << std::endl;
+				if(wait>=0) {
+					//sleeps until the bias is set up rather than spinning on the scheduler's lock
+					omp_set_lock(&setup[wait]);
+					omp_unset_lock(&setup[wait]);
+					continue;
 				}
-			}
-
-		}	//trails ends
-
-		std::cout << "trials finished" << std::endl;
-
-		//write the total current data to a file
-		std::string str1;//(100,'\0');
-		for(int num=0;num<10;num++)
-		{
-			std::ofstream fp_transient_current;
-			std::string fname(100,'\0');
-			std::snprintf(&fname[0],fname.size(),"%d_trial_current.txt",num);
-			std::cout << fname << std::endl;
-			fp_transient_current.open(fname);
-			
-			for(int i=0; i<CurrentArray-1; i++)
-			{
-				char _t[32];
-				char _c[32];
-				std::snprintf(&_t[0],32,"%g",timestep*i);
-				std::snprintf(&_c[0],32,"%g",ITotalCurrent[num*CurrentArray+i]);
-				str1 = _t;
-				str1 += ',';
-				str1 += _c;
-				str1 += '\n';
-
-				//std::snprintf(&str1[0],str1.size(),"%g,%g",(timestep*i),ITotalCurrent[num*CurrentArray+i]);
-				//std::cout << str1 << std::endl;
-				fp_transient_current << str1;
-			}
-		
-			fp_transient_current.close();
-		}
-
-		delete[] ITotalCurrent;
-
-		F=Ms/(gain*gain);
-		Pbreakdown=breakdown/Ntrials;
-
-		if(cutoff==0) {
-			printf("V= %f M= %f, F= %f, Pb= %f \n",Vsim,gain,F,Pbreakdown);
-			fprintf(out,"V= %f M= %f F= %f, Pb= %f \n",Vsim,gain,F,Pbreakdown);
-		}
-		else{
-			printf("V= %f M= cutoff, F= cutoff, Pb= %f \n",Vsim,Pbreakdown);
-			fprintf(out,"V= %f M= cutoff F= cutoff, Pb= %f \n",Vsim,Pbreakdown);
-		}
-		fflush(out);
-		fclose(tbout);
-		if(breakdown==0) {
-			FILE *Iout;
-			char name[] = "current.txt";
-			char Vsimchar[8];
-			snprintf(Vsimchar, sizeof(Vsimchar),"%g", Vsim);
-			int filespec_len = strlen(name) + strlen(Vsimchar) + 1;
-			char *fileSpec=new char[filespec_len];
-			snprintf(fileSpec,filespec_len, "%s%s", Vsimchar, name);
-			if ((Iout=fopen(fileSpec,"w"))==NULL)
-			{
-				printf("Error: current.txt\n");
-			}
-			delete[] fileSpec;
-			fprintf(Iout,"V= %f \n", Vsim);
-			fprintf(Iout,"time step size in %e s\n",timestep);
-			fprintf(Iout,"t                I \n");
-			int Ioutprint =0;
-			int i;
-			for(i=0; i<CurrentArray; i++) {
-				double timeprint=timestep*i;
-				double current = I[i]/(double)Ntrials;
-				double count=I[i]/(constants.Get_q()*(double)Ntrials);
-				if(I[i]>0 && Ioutprint <50) {
-					fprintf(Iout,"%g %g \n",timeprint,current);
-					Ioutprint=0;
+				if(b==NULL) break;
+				double start=omp_get_wtime();
+				int trials=b->run(c,engine);
+				double elapsed=omp_get_wtime()-start;
+				int fold=0;
+				int done=0;
+				#pragma omp critical(schedule)
+				{
+					b->Input_ready(c);
+					b->cost+=elapsed;
+					b->costed+=trials;
+					spent_trials+=trials;
+					spent_seconds+=elapsed;
+					if(!b->folding && !b->stopped && b->Get_ready(b->folded)) {
+						b->folding=1;
+						fold=1;
+					}
+					done=b->Get_done(); //a stopped bias waits for the chunks it handed out
 				}
-				else if(Ioutprint <50) {
-					fprintf(Iout,"%g %g \n",timeprint,current);
-					Ioutprint++;
+				if(done) write_done(point,bias_count,&written,&writing,out,errors);
+				//the thread that finishes the next chunk of a bias adds it and any finished chunks after it
+				while(fold) {
+					int stop=b->fold(b->folded);
+					#pragma omp critical(schedule)
+					{
+						b->folded++;
+						if(stop) {
+							//the chunks after this one are dropped, the ones already running are waited for
+							b->stopped=1;
+							if(next>=0 && point[next]==b) next=-1;
+						}
+						fold=!b->stopped && b->Get_ready(b->folded);
+						if(!fold) b->folding=0;
+						done=b->Get_done();
+					}
 				}
+				if(done) write_done(point,bias_count,&written,&writing,out,errors);
 			}
-			fflush(Iout);
-			fclose(Iout);
+			delete engine;
 		}
-		delete [] I;
-		delete [] Inum;
-		fclose(counter);
-		fclose(Mout);
+		round=budget && allocate(point,V,bias_count,budget_trials,budget_seconds,spent_trials,spent_seconds);
 	}
-	electron->~carrier();
-	hole->~carrier();
-	delete electron;
-	delete hole;
+	int i;
+	for(i=written; i<bias_count; i++) if(point[i]!=NULL) point[i]->stopped=1; //the budget is spent
+	write_done(point,bias_count,&written,&writing,out,errors);
+	for(i=0; i<bias_count; i++) omp_destroy_lock(&setup[i]);
+	delete[] setup;
+	delete[] setting;
+	delete[] point;
+	delete[] started;
 	fclose(out);
+	if(errors!=NULL) fclose(errors);
 	postprocess(V, simulationtime, bias_count);
 	delete[] V;
 }
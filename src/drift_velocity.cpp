@@ -36,6 +36,7 @@
 #include "SMC.h"
 #include "functions.h"
 #include "tools.h"
+#include "rng.h"
 #include <stdio.h>
 #include <math.h>
 
@@ -50,7 +51,7 @@ void drift_velocity(int material){
 	scanf("%lf",&maxEfield);
 	tools simulation(pointSMC);
 	simulation.scattering_probability();//this function returns 0 if no output can be generated and the user wants to quit
-	sgenrand(4358);//seeds the random number generator constant used to alow for comparison using different parameters.
+	rng random(4358);//seeds the random number generator constant used to alow for comparison using different parameters.
 	double Esim,Eloop,z_pos,kf,kxy,kz,cos_theta,Energy;
 	int tn;
 	int scat_e=0;
@@ -58,7 +59,8 @@ void drift_velocity(int material){
 	FILE *hpdf;
 	epdf=fopen("evelocity.txt","w");
 	hpdf=fopen("hvelocity.txt","w");
-	for(Esim=minEfield; Esim<=maxEfield; Esim+=1) {
+	int Eindex=0; //selects the random number streams for each electric field
+	for(Esim=minEfield; Esim<=maxEfield; Esim+=1, Eindex++) {
 
 		Eloop=Esim*1e5;//change elecric field from kV/cm to V/m.
 		z_pos=0;
@@ -71,58 +73,59 @@ void drift_velocity(int material){
 		double drift_t=0;
 		double dE=0;
 		int counter=0;
-		double vtotal=0;
+		//the drift velocity is the distance travelled over the time taken, free flights are shorter at high energy
+		//so a plain average of the velocity of each flight would be weighted towards the high energy carriers
+		double distance=0, flight_time=0;
+		double events=0, selfevents=0; //scattering events and the self-scatterings among them
 		//electrons
+		random.stream(Eindex,0,0);
 		for(counter=0; counter<1000000; counter++) { //loop for 1000000 scattering events
 			if(scat_e==0) {
 				double cos_theta;
 				kf=2*constants.Get_e_mass()*Energy/(constants.Get_hbar()*constants.Get_hbar());
 				if(kf>=0) {
-					cos_theta=2*genrand()-1;
+					cos_theta=2*random.genrand()-1;
 					kz=cos_theta*sqrt(kf);
 					kxy=kf*(1-cos_theta*cos_theta);
 				}
 			}
 			//electron drift process starts
-			double random1;
-			random1=genrand();
-			drift_t= -log(random1)/(simulation.Get_rtotal());
+			int band=simulation.band(Energy);
+			drift_t=random.exprand()/simulation.Get_rate(0,band); //exponentially distributed free flight time
+			int crossed=simulation.band_exit(0,band,kxy,kz,(constants.Get_q()*Eloop)/(constants.Get_hbar()),&drift_t);
 			kz+=(constants.Get_q()*drift_t*Eloop)/(constants.Get_hbar());
 			dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz)-Energy;
 			Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz);
 			z_pos+=dE/(constants.Get_q()*Eloop);
 			//electron drift process ends
-			double velocity = dE/(constants.Get_q()*Eloop*drift_t);
-			vtotal += (velocity);
+			distance+=dE/(constants.Get_q()*Eloop);
+			flight_time+=drift_t;
 			// electron scattering process starts
-			double random2;
-			int Eint;
-			Eint=(int)floor(Energy*1000.0/constants.Get_q()+0.5);
-			if (Energy>constants.Get_Emax()) {
-				Eint= constants.Get_NUMPOINTS();
-				random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());
-			}
-			else if (Energy == constants.Get_Emax()) random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());
-			else random2=genrand();
-
-			if(random2<=simulation.Get_pb(0,Eint)) //phonon absorption
-			{   Energy+=constants.Get_hw();
-				scat_e=0;}
-			else if(random2<=simulation.Get_pb(1,Eint)) //phonon emission
-			{   Energy-=constants.Get_hw();
-				scat_e=0;}
-			else if(random2<=simulation.Get_pb(2,Eint)) //impact ionization
-			{   Energy=(Energy-constants.Get_e_Eth())/3.0;
+			events++;
+			switch(crossed ? SCAT_SELF : simulation.select(0,Energy,band,&random))
+			{
+			case SCAT_ABSORPTION: //phonon absorption
+				Energy+=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_EMISSION: //phonon emission
+				Energy-=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_IONIZATION: //impact ionization
+				Energy=(Energy-constants.Get_e_Eth())/3.0;
 				tn++;
 				scat_e=0;
-
-				z_pos=0;}
-			else if(random2>simulation.Get_pb(2,Eint)) //selfscattering
-			{    scat_e=1;}
+				z_pos=0;
+				break;
+			default: //selfscattering
+				scat_e=1;
+				selfevents++;
+			}
 			//electron scattering process ends
 
 		}
-		double vmean=vtotal/counter;
+		double vmean=distance/flight_time;
 		fprintf(epdf,"%g %g\n", Esim, vmean);
 
 		z_pos=0;
@@ -134,58 +137,58 @@ void drift_velocity(int material){
 		tn=0;
 		drift_t=0;
 		dE=0;
-		double vtotalh=0;
+		distance=0;
+		flight_time=0;
 		//holes
+		random.stream(Eindex,0,1);
 		for(counter=0; counter<1000000; counter++) {
 			if(scat_e==0) {
 				double cos_theta;
 				kf=2*constants.Get_h_mass()*Energy/(constants.Get_hbar()*constants.Get_hbar());
 				if(kf>=0) {
-					cos_theta=2*genrand()-1;
+					cos_theta=2*random.genrand()-1;
 					kz=cos_theta*sqrt(kf);
 					kxy=kf*(1-cos_theta*cos_theta);
 				}
 			}
 			//hole drift process starts
-			double random11;
-			random11=genrand();
-			drift_t= -log(random11)/simulation.Get_rtotal2();
+			int band=simulation.band(Energy);
+			drift_t=random.exprand()/simulation.Get_rate(1,band);
+			int crossed=simulation.band_exit(1,band,kxy,kz,-(constants.Get_q()*Eloop)/(constants.Get_hbar()),&drift_t);
 			kz-=((constants.Get_q()*drift_t*Eloop)/(constants.Get_hbar()));
 			dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz)-Energy;
 			Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz);
 			z_pos-=dE/(Eloop*constants.Get_q());
 			//hole drift process ends
-			double velocity = dE/(Eloop*constants.Get_q()*drift_t);
-			vtotalh+= (velocity);
-			double random22;
-			int Eint2;
-			Eint2=(int)floor(Energy*1000.0/constants.Get_q()+0.5);
-			if (Energy>constants.Get_Emax()) {
-				Eint2= constants.Get_NUMPOINTS();
-				random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());
-			}
-			else if (Energy == constants.Get_Emax()) random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());
-			else random22=genrand();
-
-			if(random22<=simulation.Get_pb2(0,Eint2)) //phonon absorption
-			{   Energy+=constants.Get_hw();
-				scat_e=0;}
-			else if(random22<=simulation.Get_pb2(1,Eint2)) //phonon emission
-			{   Energy-=constants.Get_hw();
-				scat_e=0;}
-			else if(random22<=simulation.Get_pb2(2,Eint2)) //impact ionization
-			{   Energy=(Energy-constants.Get_h_Eth())/3.0;
+			distance+=dE/(Eloop*constants.Get_q()); //holes drift against z_pos, the velocity is quoted positive
+			flight_time+=drift_t;
+			events++;
+			switch(crossed ? SCAT_SELF : simulation.select(1,Energy,band,&random))
+			{
+			case SCAT_ABSORPTION: //phonon absorption
+				Energy+=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_EMISSION: //phonon emission
+				Energy-=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_IONIZATION: //impact ionization
+				Energy=(Energy-constants.Get_h_Eth())/3.0;
 				tn++;
 				scat_e=0;
-
-				z_pos=0;}
-			else if(random22>simulation.Get_pb2(2,Eint2)) //selfscattering
-			{    scat_e=1;}
+				z_pos=0;
+				break;
+			default: //selfscattering
+				scat_e=1;
+				selfevents++;
+			}
 			//electron scattering process ends
 
 		}
-		vmean=vtotalh/counter;
+		vmean=distance/flight_time;
 		fprintf(hpdf,"%g %g\n", Esim, vmean);
+		printf("%g kV/cm Self-scattering fraction= %f \n", Esim, selfevents/events);
 
 	}
 	fclose(epdf);
@@ -24,47 +24,35 @@
 #include <math.h>
 #include <stdio.h>
 #include <conio.h>
+#include <string.h>
 
 double _max(double x,double y)
 {
 	if(x>y) return x;
 	else return y;
 };
-// seeds the random number generator
-void sgenrand(unsigned long seed)
-{
-	int i;
-	for (i=0; i<Nr; i++)
-	{    mt[i] = seed & 0xffff0000;
-		 seed = 69069*seed+1;
-		 mt[i]=(seed & 0xffff0000)>>16;
-		 seed = 69069*seed+1;}
-	mti=Nr;
+
+//Returns the value of the option name from smc_options.txt
+double read_option(const char *name, double default_value){
+	char text[256];
+	double value;
+	if(read_option_text(name,text,sizeof(text)) && sscanf(text,"%lf",&value)==1) return value;
+	return default_value;
 };
 
-//calculates the next random number in the seeded mersenne twister.
-double genrand(){ //quite a lot of the parameters in this function are #defined in default_include.h
-	double ans;
-	unsigned long y;
-	static unsigned long mag01[2] = {0x0, MATRIX_A};
-	if (mti >= Nr) //generate N words at one time
-	{    int kk;
-		 if (mti == Nr+1) sgenrand(4357); //sets initial seed
-		 for (kk=0; kk<(Nr-M); kk++)
-		 {    y=(mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-		  mt[kk] = mt[kk+M] ^ (y>>1) ^ mag01[y & 0x1];}
-		 for (; kk<Nr-1; kk++)
-		 {    y=(mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-		  mt[kk] = mt[kk+(M-Nr)] ^ (y>>1) ^ mag01[y & 0x1];}
-		 y=(mt[Nr-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
-		 mt[Nr-1]=mt[M-1]^(y>>1)^mag01[y &0x1];
-		 mti=0;}
-	y = mt[mti++];
-	y ^= TEMPERING_SHIFT_U (y);
-	y ^= TEMPERING_SHIFT_S (y) & TEMPERING_MASK_B;
-	y ^= TEMPERING_SHIFT_T (y) & TEMPERING_MASK_C;
-	y ^= TEMPERING_SHIFT_L (y);
-	ans= ( double   )y * 2.3283064365386963e-10;
-	while ((ans<=0)||(ans>=1)) ans=genrand();
-	return ans;
+//Copies the text of the option name from smc_options.txt into value
+int read_option_text(const char *name, char *value, int size){
+	FILE *options;
+	if((options=fopen("smc_options.txt","r"))==NULL) return 0;
+	char line[512], key[256], text[256];
+	int found=0;
+	while(!found && fgets(line,sizeof(line),options)!=NULL) {
+		if(line[0]=='#') continue;
+		if(sscanf(line,"%255s %255s",key,text)==2 && strcmp(key,name)==0) {
+			snprintf(value,size,"%s",text);
+			found=1;
+		}
+	}
+	fclose(options);
+	return found;
 };
@@ -23,26 +23,12 @@
 #ifndef FUNC_H
 #define FUNC_H
 
-/* Random Generator Initilization*/
-/* Period parameters */
-#define Nr 624
-#define M 397
-#define MATRIX_A 0x9908b0df     /* constant vector a */
-#define UPPER_MASK 0x80000000   /* most significant w-r bits */
-#define LOWER_MASK 0x7fffffff   /* least significant r bits */
-
-/* Tempering parameters */
-#define TEMPERING_MASK_B 0x9d2c5680
-#define TEMPERING_MASK_C 0xefc60000
-#define TEMPERING_SHIFT_U(y)  (y >> 11)
-#define TEMPERING_SHIFT_S(y)  (y << 7)
-#define TEMPERING_SHIFT_T(y)  (y << 15)
-#define TEMPERING_SHIFT_L(y)  (y >> 18)
-
-
-static unsigned long mt[Nr];
-static int mti = Nr+1;
 double _max(double x, double y);
-void sgenrand(unsigned long seed);
-double genrand();
+
+/* Optional settings, read from smc_options.txt in the working directory.
+   Each line is "name value", lines starting with # are comments. */
+//Returns the value of the option name, or default_value if the file or option is missing
+double read_option(const char *name, double default_value);
+//Copies the text of the option name into value, returns 0 if the file or option is missing
+int read_option_text(const char *name, char *value, int size);
 #endif
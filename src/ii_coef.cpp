@@ -35,6 +35,7 @@
 #include "SMC.h"
 #include "functions.h"
 #include "tools.h"
+#include "rng.h"
 #include <stdio.h>
 #include <math.h>
 #include <tchar.h>
@@ -52,7 +53,7 @@ void ii_coef(int material){
 	scanf("%lf",&stepEfield);
 	tools simulation(pointSMC);
 	simulation.scattering_probability();//this function returns 0 if no output can be generated and the user wants to quit
-	sgenrand(4358);//seeds the random number generator constant used to alow for comparison using different parameters.
+	rng random(4358);//seeds the random number generator constant used to alow for comparison using different parameters.
 	double Esim,Eloop,z_pos,kf,kxy,kz,cos_theta,Energy;
 	int tn;
 	int scat_e=0;
@@ -61,7 +62,8 @@ void ii_coef(int material){
 	fprintf(about,"Efield (kV/cm),  Alpha (1/m), Beta (1/m)\n");
 
 	/*** EFIELD LOOP STARTS HERE ***/
-	for(Esim=minEfield; Esim<=maxEfield; Esim+=stepEfield) {
+	int Eindex=0; //selects the random number streams for each electric field
+	for(Esim=minEfield; Esim<=maxEfield; Esim+=stepEfield, Eindex++) {
 		//Generate the output files for the electric field
 		FILE *epdf;
 		FILE *hpdf;
@@ -91,22 +93,24 @@ void ii_coef(int material){
 		double dE=0;
 		double alpha_distance=0;
 		double beta_distance=0;
+		double events=0, selfevents=0; //scattering events and the self-scatterings among them
 
 		//electrons
+		random.stream(Eindex,0,0);
 		while(tn<20000) { //loops for 20000 electron impact ionization events.
 			if(scat_e==0) {
 				double cos_theta;
 				kf=2*constants.Get_e_mass()*Energy/(constants.Get_hbar()*constants.Get_hbar());
 				if(kf>=0) {
-					cos_theta=2*genrand()-1;
+					cos_theta=2*random.genrand()-1;
 					kz=cos_theta*sqrt(kf);
 					kxy=kf*(1-cos_theta*cos_theta);
 				}
 			}
 			//electron drift process starts
-			double random1;
-			random1=genrand();
-			drift_t= -log(random1)/(simulation.Get_rtotal());
+			int band=simulation.band(Energy);
+			drift_t=random.exprand()/simulation.Get_rate(0,band); //exponentially distributed free flight time
+			int crossed=simulation.band_exit(0,band,kxy,kz,(constants.Get_q()*Eloop)/(constants.Get_hbar()),&drift_t);
 			kz+=(constants.Get_q()*drift_t*Eloop)/(constants.Get_hbar());
 			dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz)-Energy;
 			Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_e_mass()))*(kxy+kz*kz);
@@ -114,31 +118,29 @@ void ii_coef(int material){
 			//electron drift process ends
 
 			//electron scattering process starts
-			double random2;
-			int Eint;
-			Eint=(int)floor(Energy*1000.0/constants.Get_q()+0.5); //bins energy to compare against probability curves from tools class.
-			if (Energy>constants.Get_Emax()) {
-				Eint= constants.Get_NUMPOINTS();
-				random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());
-			}
-			else if (Energy == constants.Get_Emax()) random2=simulation.Get_pb(2,constants.Get_NUMPOINTS());
-			else random2=genrand();
-
-			if(random2<=simulation.Get_pb(0,Eint)) //phonon absorption
-			{   Energy+=constants.Get_hw();
-				scat_e=0;}
-			else if(random2<=simulation.Get_pb(1,Eint)) //phonon emission
-			{   Energy-=constants.Get_hw();
-				scat_e=0;}
-			else if(random2<=simulation.Get_pb(2,Eint)) //impact ionization
-			{   Energy=(Energy-constants.Get_e_Eth())/3.0;
+			events++;
+			switch(crossed ? SCAT_SELF : simulation.select(0,Energy,band,&random))
+			{
+			case SCAT_ABSORPTION: //phonon absorption
+				Energy+=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_EMISSION: //phonon emission
+				Energy-=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_IONIZATION: //impact ionization
+				Energy=(Energy-constants.Get_e_Eth())/3.0;
 				tn++;
 				scat_e=0;
 				fprintf(epdf,"%d %e\n", tn, z_pos);
 				alpha_distance+=z_pos;
-				z_pos=0;}
-			else if(random2>simulation.Get_pb(2,Eint)) //selfscattering
-			{    scat_e=1;}
+				z_pos=0;
+				break;
+			default: //selfscattering
+				scat_e=1;
+				selfevents++;
+			}
 			//electron scattering process ends
 
 		}
@@ -155,20 +157,21 @@ void ii_coef(int material){
 		dE=0;
 
 		//holes
+		random.stream(Eindex,0,1);
 		while(tn<20000) {// loops for 20000 impact ionization events for holes.
 			if(scat_e==0) {
 				double cos_theta;
 				kf=2*constants.Get_h_mass()*Energy/(constants.Get_hbar()*constants.Get_hbar());
 				if(kf>=0) {
-					cos_theta=2*genrand()-1;
+					cos_theta=2*random.genrand()-1;
 					kz=cos_theta*sqrt(kf);
 					kxy=kf*(1-cos_theta*cos_theta);
 				}
 			}
 			//hole drift process starts
-			double random11;
-			random11=genrand();
-			drift_t= -log(random11)/simulation.Get_rtotal2();
+			int band=simulation.band(Energy);
+			drift_t=random.exprand()/simulation.Get_rate(1,band);
+			int crossed=simulation.band_exit(1,band,kxy,kz,-(constants.Get_q()*Eloop)/(constants.Get_hbar()),&drift_t);
 			kz-=((constants.Get_q()*drift_t*Eloop)/(constants.Get_hbar()));
 			dE=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz)-Energy;
 			Energy=((constants.Get_hbar()*constants.Get_hbar())/(2*constants.Get_h_mass()))*(kxy+kz*kz);
@@ -176,31 +179,29 @@ void ii_coef(int material){
 			//hole drift process ends
 
 			// hole scattering process starts
-			double random22;
-			int Eint2;
-			Eint2=(int)floor(Energy*1000.0/constants.Get_q()+0.5);
-			if (Energy>constants.Get_Emax()) {
-				Eint2= constants.Get_NUMPOINTS();
-				random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());
-			}
-			else if (Energy == constants.Get_Emax()) random22=simulation.Get_pb2(2,constants.Get_NUMPOINTS());
-			else random22=genrand();
-
-			if(random22<=simulation.Get_pb2(0,Eint2)) //phonon absorption
-			{   Energy+=constants.Get_hw();
-				scat_e=0;}
-			else if(random22<=simulation.Get_pb2(1,Eint2)) //phonon emission
-			{   Energy-=constants.Get_hw();
-				scat_e=0;}
-			else if(random22<=simulation.Get_pb2(2,Eint2)) //impact ionization
-			{   Energy=(Energy-constants.Get_h_Eth())/3.0;
+			events++;
+			switch(crossed ? SCAT_SELF : simulation.select(1,Energy,band,&random))
+			{
+			case SCAT_ABSORPTION: //phonon absorption
+				Energy+=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_EMISSION: //phonon emission
+				Energy-=constants.Get_hw();
+				scat_e=0;
+				break;
+			case SCAT_IONIZATION: //impact ionization
+				Energy=(Energy-constants.Get_h_Eth())/3.0;
 				tn++;
 				scat_e=0;
 				fprintf(hpdf,"%d %e\n", tn, -z_pos);
 				beta_distance-=z_pos;
-				z_pos=0;}
-			else if(random22>simulation.Get_pb2(2,Eint2)) //selfscattering
-			{    scat_e=1;}
+				z_pos=0;
+				break;
+			default: //selfscattering
+				scat_e=1;
+				selfevents++;
+			}
 			//hole scattering process ends
 
 		}
@@ -211,6 +212,7 @@ void ii_coef(int material){
 		double alpha=tn/alpha_distance;
 		double beta=tn/beta_distance;
 		fprintf(about, "%lf %e %e\n", Esim, alpha, beta);
+		printf("%g kV/cm Self-scattering fraction= %f \n", Esim, selfevents/events);
 	}
 	fclose(about);
 }
@@ -0,0 +1,64 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   rng.h contains the class definition for the rng class for the SMC
+   The rng class is a counter-based (Philox4x32-10) random number generator. Each thread should use its own
+   generator.
+
+   rng_class.cpp contains the class implimentation
+ */
+
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+
+const int RNG_LANES=16;    //blocks generated side by side in fill(), lets the compiler vectorise the rounds
+const int RNG_BUFFER=256;  //random numbers held in each generator's buffer
+const int ZIG_LAYERS=256;  //layers in the exponential ziggurat, uses the low 8 bits of a word
+
+class rng {
+private:
+	uint32_t key[2];     //from the seed
+	uint32_t counter[4]; //block number, carrier stream, trial index, bias index
+	double buffer[RNG_BUFFER]; //numbers waiting to be used by genrand()
+	int used;            //number of entries of buffer already returned
+	void refill();
+	static uint32_t zig_k[ZIG_LAYERS]; //ziggurat acceptance limits for the top 24 bits of a word
+	static double zig_w[ZIG_LAYERS];   //ziggurat layer widths per unit of the top 24 bits
+	static double zig_f[ZIG_LAYERS];   //exp(-x) at the layer edges
+	static bool ziggurat();            //sets up the ziggurat tables, called once
+	double exprand_edge(int layer, uint32_t j); //rejection step for the layer edges and the tail
+public:
+	rng(unsigned long seed);
+	void stream(int bias, int trial, int carrier); //selects and rewinds a stream, any trial can be reproduced on its own
+	void chunk_stream(int bias, int trial, int sweep, int chunk); //stream of a chunk of carriers stepped in parallel
+	void fill(double *out, int n); //writes the next n random numbers on (0,1) to out
+	//returns the next random number in the buffer filled by fill(), never returns 0 or 1.
+	inline double genrand(){
+		if(used>=RNG_BUFFER) refill();
+		return buffer[used++];
+	};
+	//returns an exponentially distributed random number with mean 1 from the ziggurat, never returns 0.
+	//Replaces -log(genrand()) for the free flight times.
+	inline double exprand(){
+		uint32_t word=(uint32_t)(genrand()*4294967296.0); //recovers the 32 bit word behind genrand()
+		int layer=word&(ZIG_LAYERS-1);
+		uint32_t j=word>>8;
+		if(j<zig_k[layer]) return (j+0.5)*zig_w[layer]; //centred in the step so 0 is never returned
+		return exprand_edge(layer,j);
+	};
+};
+#endif
@@ -0,0 +1,166 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   rng_class.cpp contains the class implimentation for the rng class for the SMC
+   The rng class is a counter-based (Philox4x32-10) random number generator.
+   Salmon et al., 'Parallel random numbers: as easy as 1, 2, 3', SC11, 2011.
+   The exponential ziggurat follows Marsaglia & Tsang, 'The Ziggurat Method for Generating Random Variables',
+   J. Stat. Softw. 5(8), 2000.
+
+   rng.h contains the class definition
+ */
+
+#include "rng.h"
+#include <math.h>
+
+//Philox4x32 multipliers and Weyl key increments
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9
+#define PHILOX_W1 0xBB67AE85
+#define PHILOX_ROUNDS 10
+
+//Exponential ziggurat, right hand edge of the base layer and the area of each layer
+#define ZIG_R 7.697117470131487
+#define ZIG_V 3.949659822581572e-3
+#define ZIG_M 16777216.0 //2^24, range of the part of the word used for the position in a layer
+
+uint32_t rng::zig_k[ZIG_LAYERS];
+double rng::zig_w[ZIG_LAYERS];
+double rng::zig_f[ZIG_LAYERS];
+
+//Applies the Philox4x32-10 rounds to RNG_LANES counters stored as structure-of-arrays,
+//each round is a straight loop over the lanes that the compiler turns into vector multiplies.
+static void philox_rounds(uint32_t *__restrict c0, uint32_t *__restrict c1, uint32_t *__restrict c2,
+                          uint32_t *__restrict c3, uint32_t k0, uint32_t k1){
+	int l, r;
+	for(r=0; r<PHILOX_ROUNDS; r++) {
+		for(l=0; l<RNG_LANES; l++) {
+			uint64_t p0=(uint64_t)c0[l]*PHILOX_M0;
+			uint64_t p1=(uint64_t)c2[l]*PHILOX_M1;
+			uint32_t n0=(uint32_t)(p1>>32)^c1[l]^k0;
+			uint32_t n2=(uint32_t)(p0>>32)^c3[l]^k1;
+			c1[l]=(uint32_t)p1;
+			c3[l]=(uint32_t)p0;
+			c0[l]=n0;
+			c2[l]=n2;
+		}
+		k0+=PHILOX_W0;
+		k1+=PHILOX_W1;
+	}
+};
+
+//Constructor, keys the generator with the seed and selects stream 0,0,0
+rng::rng(unsigned long seed){
+	static bool tables=ziggurat(); //builds the shared ziggurat tables on first use
+	(void)tables;
+	key[0]=(uint32_t)seed;
+	key[1]=(uint32_t)((unsigned long long)seed>>32);
+	stream(0,0,0);
+};
+
+//Selects the stream for a carrier stream of a trial at a bias and starts it from the beginning
+void rng::stream(int bias, int trial, int carrier){
+	counter[0]=0;
+	counter[1]=(uint32_t)carrier;
+	counter[2]=(uint32_t)trial;
+	counter[3]=(uint32_t)bias;
+	used=RNG_BUFFER;
+};
+
+//Selects the stream of chunk of the carriers stepped in parallel in sweep of a trial, bias and chunk below 32768.
+//The chunk is held above the bias in the top half of the bias word, with the top bit set so these streams never
+//meet the ones from stream().
+void rng::chunk_stream(int bias, int trial, int sweep, int chunk){
+	counter[0]=0;
+	counter[1]=(uint32_t)sweep;
+	counter[2]=(uint32_t)trial;
+	counter[3]=((uint32_t)bias&0x7FFF)|((uint32_t)chunk<<16)|0x80000000u;
+	used=RNG_BUFFER;
+};
+
+//Generates the next n random numbers of the stream into out.
+//RNG_LANES consecutive counters are encrypted together, words left over from the last group are discarded.
+void rng::fill(double *out, int n){
+	uint32_t c0[RNG_LANES], c1[RNG_LANES], c2[RNG_LANES], c3[RNG_LANES];
+	int l, j;
+	while(n>0) {
+		for(l=0; l<RNG_LANES; l++) {
+			c0[l]=counter[0]+(uint32_t)l;
+			c1[l]=counter[1];
+			c2[l]=counter[2];
+			c3[l]=counter[3];
+		}
+		philox_rounds(c0,c1,c2,c3,key[0],key[1]);
+		counter[0]+=RNG_LANES;
+		//(word+0.5)/2^32 maps every word strictly inside (0,1), no rejection needed
+		uint32_t words[4*RNG_LANES];
+		for(l=0; l<RNG_LANES; l++) {
+			words[4*l]=c0[l];
+			words[4*l+1]=c1[l];
+			words[4*l+2]=c2[l];
+			words[4*l+3]=c3[l];
+		}
+		int m=(n<4*RNG_LANES) ? n : 4*RNG_LANES;
+		for(j=0; j<m; j++) {
+			out[j]=((double)words[j]+0.5)*2.3283064365386963e-10;
+		}
+		out+=m;
+		n-=m;
+	}
+};
+
+//Refills the buffer used by genrand()
+void rng::refill(){
+	fill(buffer,RNG_BUFFER);
+	used=0;
+};
+
+//Sets up the ziggurat tables for exprand(), layer 0 is the base strip including the tail.
+bool rng::ziggurat(){
+	double de=ZIG_R, te=ZIG_R;
+	double q=ZIG_V/exp(-de);
+	int i;
+	zig_k[0]=(uint32_t)((de/q)*ZIG_M);
+	zig_k[1]=0;
+	zig_w[0]=q/ZIG_M;
+	zig_w[ZIG_LAYERS-1]=de/ZIG_M;
+	zig_f[0]=1.0;
+	zig_f[ZIG_LAYERS-1]=exp(-de);
+	for(i=ZIG_LAYERS-2; i>=1; i--) {
+		de=-log(ZIG_V/de+exp(-de));
+		zig_k[i+1]=(uint32_t)((de/te)*ZIG_M);
+		te=de;
+		zig_f[i]=exp(-de);
+		zig_w[i]=de/ZIG_M;
+	}
+	return true;
+};
+
+//exprand() lands here about 1% of the time, when the point is outside the rectangle
+//fully inside the curve. Samples the tail from the base layer or accepts/rejects against exp(-x).
+double rng::exprand_edge(int layer, uint32_t j){
+	double x;
+	while(1) {
+		if(layer==0) return ZIG_R-log(genrand());
+		x=(j+0.5)*zig_w[layer];
+		if(zig_f[layer]+genrand()*(zig_f[layer-1]-zig_f[layer])<exp(-x)) return x;
+		uint32_t word=(uint32_t)(genrand()*4294967296.0);
+		layer=word&(ZIG_LAYERS-1);
+		j=word>>8;
+		if(j<zig_k[layer]) return (j+0.5)*zig_w[layer];
+	}
+};
@@ -0,0 +1,116 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   rng_test.cpp is a build step, run by Makefile.bat before smc is compiled.
+   It checks that rng::exprand() follows the exponential distribution of -log(genrand()) that it replaces,
+   with chi-square tests of the whole range and of the tail beyond 4 and 8, a Kolmogorov-Smirnov test and the
+   first three moments. The seeds are fixed so the result is the same on every run, it returns 1 if any
+   statistic is outside its 99.9% range.
+
+   Built with rng_class.cpp.
+ */
+
+#include "rng.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLES 40000000 //draws for the chi-square tests and the moments
+#define KS_SAMPLES 1000000
+#define BINS 160         //bins of equal probability under Exp(1)
+#define TAIL_BINS 16     //fewer bins beyond 8, where there are about 13000 samples
+#define Z 3.09           //99.9% point of the normal distribution
+
+//chi works out the chi-square statistic of count[bins] against equal probabilities and prints it,
+//returns 1 if it is above the 99.9% point, from the Wilson-Hilferty approximation
+int chi(const char *name, const long *count, int bins){
+	long n=0;
+	int i;
+	for(i=0; i<bins; i++) n+=count[i];
+	double expected=(double)n/bins, chi2=0;
+	for(i=0; i<bins; i++) chi2+=(count[i]-expected)*(count[i]-expected)/expected;
+	double dof=bins-1;
+	double limit=dof*pow(1-2/(9*dof)+Z*sqrt(2/(9*dof)),3);
+	printf("rng_test: %s chi-square %g over %ld samples, limit %g\n",name,chi2,n,limit);
+	return chi2>limit;
+};
+
+//bin returns the bin of x, with x at least 0, out of bins bins of equal probability under Exp(1)
+int bin(double x, int bins){
+	int b=(int)((1-exp(-x))*bins);
+	return (b<bins) ? b : bins-1;
+};
+
+int compare(const void *a, const void *b){
+	double x=*(const double *)a, y=*(const double *)b;
+	return (x>y)-(x<y);
+};
+
+int main(){
+	static long all[BINS], over4[BINS], over8[TAIL_BINS];
+	int failed=0;
+	long i;
+	double lowest=HUGE_VAL, m1=0, m2=0, m3=0;
+	rng random(5489);
+	for(i=0; i<SAMPLES; i++) {
+		if(i%(SAMPLES/4)==0) random.stream(1,(int)(i/(SAMPLES/4)),0); //a few streams
+		double x=random.exprand();
+		if(x<lowest) lowest=x;
+		m1+=x;
+		m2+=x*x;
+		m3+=x*x*x;
+		all[bin(x,BINS)]++;
+		//Exp(1) has no memory, beyond a cut the excess is Exp(1) again. Beyond 8 is the ziggurat's tail.
+		if(x>4) over4[bin(x-4,BINS)]++;
+		if(x>8) over8[bin(x-8,TAIL_BINS)]++;
+	}
+	failed|=chi("exprand",all,BINS);
+	failed|=chi("exprand beyond 4",over4,BINS);
+	failed|=chi("exprand beyond 8",over8,TAIL_BINS);
+
+	//moments of Exp(1) are 1, 2 and 6, the standard errors come from the moments up to the sixth, 2, 24 and 720
+	double n=SAMPLES;
+	m1/=n;
+	m2/=n;
+	m3/=n;
+	double e1=fabs(m1-1)/sqrt((2-1)/n), e2=fabs(m2-2)/sqrt((24-4)/n), e3=fabs(m3-6)/sqrt((720-36)/n);
+	printf("rng_test: exprand moments %g %g %g, %g %g %g standard errors from 1 2 6\n",m1,m2,m3,e1,e2,e3);
+	if(e1>Z || e2>Z || e3>Z) failed=1;
+	printf("rng_test: exprand smallest %g\n",lowest);
+	if(!(lowest>0)) failed=1;
+
+	//Kolmogorov-Smirnov, sqrt(n)D is below 1.95 99.9% of the time
+	double *x=new double[KS_SAMPLES];
+	random.stream(2,0,0);
+	for(i=0; i<KS_SAMPLES; i++) x[i]=random.exprand();
+	qsort(x,KS_SAMPLES,sizeof(double),compare);
+	double D=0;
+	for(i=0; i<KS_SAMPLES; i++) {
+		double F=1-exp(-x[i]);
+		double d=fabs(F-(double)i/KS_SAMPLES);
+		if(d>D) D=d;
+		d=fabs((double)(i+1)/KS_SAMPLES-F);
+		if(d>D) D=d;
+	}
+	delete[] x;
+	double ks=sqrt((double)KS_SAMPLES)*D;
+	printf("rng_test: exprand Kolmogorov-Smirnov sqrt(n)D %g, limit 1.95\n",ks);
+	if(ks>1.95) failed=1;
+
+	if(failed) printf("rng_test: FAILED\n");
+	else printf("rng_test: passed\n");
+	return failed;
+};
@@ -0,0 +1,69 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   table_gen.cpp is a build step, run by Makefile.bat before smc is compiled.
+   It calculates the scattering probability tables of the built-in materials in SMC::mat()
+   and writes them to builtin_tables.cpp so they are compiled into smc as read-only data.
+
+   Built with tools_class.cpp compiled with -DNO_BUILTIN_TABLES.
+ */
+
+#include "SMC.h"
+#include "tools.h"
+#include <stdio.h>
+
+#define MATERIALS 3 //materials in SMC::mat()
+
+int main(){
+	FILE *out;
+	if((out=fopen("builtin_tables.cpp","w"))==NULL) {
+		printf("Error: builtin_tables.cpp can't be opened\n");
+		return 1;
+	}
+	fprintf(out,"/* Generated by table_gen.cpp as a step of Makefile.bat, do not edit. */\n\n");
+	fprintf(out,"#include \"builtin_tables.h\"\n\n");
+	int material, i, j;
+	double rtotal[MATERIALS], rtotal2[MATERIALS];
+	unsigned long long key[MATERIALS];
+	int points[MATERIALS];
+	for(material=1; material<=MATERIALS; material++) {
+		SMC constants;
+		constants.mat(material);
+		tools simulation(&constants);
+		points[material-1]=simulation.calculate_tables();
+		key[material-1]=simulation.Get_key();
+		rtotal[material-1]=simulation.Get_rtotal();
+		rtotal2[material-1]=simulation.Get_rtotal2();
+		//%.17g prints every double so that it reads back exactly
+		//written as scatter_bin records, aligned to a cache line
+		fprintf(out,"static const double material%d[] __attribute__((aligned(64)))={\n",material);
+		for(j=0; j<points[material-1]; j++) {
+			for(i=0; i<PB_DIM1_SZ; i++) fprintf(out,"%.17g,",simulation.Get_pb(i,j));
+			fprintf(out,"0,");
+			for(i=0; i<PB_DIM1_SZ; i++) fprintf(out,"%.17g,",simulation.Get_pb2(i,j));
+			fprintf(out,"0,\n");
+		}
+		fprintf(out,"};\n\n");
+	}
+	fprintf(out,"const builtin_table builtin_tables[]={\n");
+	for(material=1; material<=MATERIALS; material++)
+		fprintf(out,"\t{%lluULL, %d, %.17g, %.17g, material%d},\n",key[material-1],points[material-1],
+		        rtotal[material-1],rtotal2[material-1],material);
+	fprintf(out,"};\n");
+	fprintf(out,"const int builtin_table_count=%d;\n",MATERIALS);
+	fclose(out);
+	return 0;
+}
@@ -24,26 +24,131 @@
 #ifndef TOOLS_H
 #define TOOLS_H
 #include "SMC.h"
+#include "rng.h"
+#include "cache_func.h"
+#include <math.h>
 
 
-const int PB_DIM2_SZ=20000;
-const int PB_DIM1_SZ=3;
+const int PB_DIM1_SZ=3; //phonon absorption, phonon emission, impact ionization
+const int PB_RECORD=8;  //doubles per energy point, electron and hole probabilities padded to one 64 byte cache line
+
+//Cumulative scattering probabilities at one energy point, electrons and holes share a cache line
+struct scatter_bin {
+	double pb[PB_DIM1_SZ];  //electrons
+	double pad;
+	double pb2[PB_DIM1_SZ]; //holes
+	double pad2;
+};
+
+//Single precision version of scatter_bin used with table_float 1, two energy points per cache line
+struct scatter_bin_f {
+	float pb[PB_DIM1_SZ];
+	float pad;
+	float pb2[PB_DIM1_SZ];
+	float pad2;
+};
+
+//Scattering mechanisms returned by select()
+#define SCAT_ABSORPTION 0
+#define SCAT_EMISSION 1
+#define SCAT_IONIZATION 2
+#define SCAT_SELF 3
+
+//Free flight rate of one energy band, the highest total scattering rate a carrier can reach while in the band
+struct flight_band {
+	double rate;  //1/s
+	double scale; //rate/rtotal, scales the random number in select() so the band's own self-scattering is used
+	double k2top; //kxy+kz^2 at the top of the band, the free flight stops there
+};
+
 class tools {
 private:
 	SMC *constants;
-	double pb[PB_DIM1_SZ][PB_DIM2_SZ];  //array of probabilities
-	double pb2[PB_DIM1_SZ][PB_DIM2_SZ];  //array of probabilities
-	void e_rate();
-	void h_rate();
+	const scatter_bin *bins; //array of probabilities [pb_size], 64 byte aligned
+	const scatter_bin_f *fbins; //the same in single precision, only one of bins and fbins is used
+	int single;        //1 for fbins, probabilities are then interpolated between energy points
+	int pb_size;       //energy points per mechanism
+	double spacing;    //energy between points in meV
+	double Emax;
+	double Escale;     //energy points per joule
+	double *table;     //bins when calculated in this run
+	mapped_file cache; //bins when read from the table cache, built-in materials use tables compiled into smc
+	flight_band *band_table; //[2][nbands], electrons then holes
+	int nbands;
+	int band_points;   //energy points per band
+	void make_bands();
+	void grid(double spacing_meV, int single_precision);
+	void e_rate(double *rate);
+	void h_rate(double *rate);
 	double rtotal;
 	double rtotal2;
 	double my_pow(double base, double exponent);
+	uint64_t table_key();
+	void calculate(double *rate);
+	int load_builtin(uint64_t key);
+	int load_tables(const char *filename, uint64_t key);
+	void write_tables(const char *filename, uint64_t key);
+	int write_text(double *rate, double *rate2);
 public:
 	tools(SMC *input);
+	~tools();
 	int scattering_probability();
+	int calculate_tables();
+	uint64_t Get_key();
 	double Get_rtotal();
 	double Get_rtotal2();
 	double Get_pb(int i, int j);
 	double Get_pb2(int i, int j);
+	int Get_nbands();
+	//Energy band of a carrier with energy Energy, the last band has no top
+	inline int band(double Energy){
+		int b=(int)(Energy*Escale+0.5)/band_points;
+		return (b<nbands) ? b : nbands-1;
+	};
+	//Free flight rate for an electron (carrier 0) or hole (carrier 1) in band b
+	inline double Get_rate(int carrier, int b){
+		return band_table[carrier*nbands+b].rate;
+	};
+	//Cuts the free flight drift_t short if it would take the carrier over the top of band b, kz changes by dkz
+	//per second during the flight. The energy is a parabola in time so only the end of the flight needs checking
+	//before solving for the crossing. Returns 1 if the flight was cut short, the carrier then self-scatters.
+	inline int band_exit(int carrier, int b, double kxy, double kz, double dkz, double *drift_t){
+		double k2top=band_table[carrier*nbands+b].k2top;
+		double kend=kz+dkz*(*drift_t);
+		if(kxy+kend*kend<=k2top) return 0;
+		double ktop=sqrt(k2top-kxy);
+		*drift_t=(dkz>0) ? (ktop-kz)/dkz : (ktop+kz)/(-dkz);
+		return 1;
+	};
+	//Selects the scattering mechanism for an electron (carrier 0) or hole (carrier 1) with energy Energy after a
+	//free flight made in band b. One table lookup, the mechanism is counted from the cumulative probabilities
+	//instead of an if chain. Double precision tables use the nearest energy point, single precision tables
+	//interpolate between the two points either side. At or above Emax the carrier impact ionizes, as the highest probability is always drawn there.
+	inline int select(int carrier, double Energy, int b, rng *random){
+		const double *p;
+		double r;
+		if(single) {
+			const float *lo;
+			if(Energy<Emax) {
+				double x=Energy*Escale;
+				int j=(int)x;
+				float f=(float)(x-j);
+				lo=(const float *)&fbins[j]+4*carrier;
+				const float *hi=lo+PB_RECORD; //next energy point
+				r=random->genrand()*band_table[carrier*nbands+b].scale;
+				return (r>lo[0]+f*(hi[0]-lo[0]))+(r>lo[1]+f*(hi[1]-lo[1]))+(r>lo[2]+f*(hi[2]-lo[2]));
+			}
+			lo=(const float *)&fbins[pb_size-1]+4*carrier;
+			return (lo[2]>lo[0])+(lo[2]>lo[1]);
+		}
+		if(Energy<Emax) {
+			p=(const double *)&bins[(int)(Energy*Escale+0.5)]+4*carrier;
+			r=random->genrand()*band_table[carrier*nbands+b].scale;
+		} else {
+			p=(const double *)&bins[pb_size-1]+4*carrier;
+			r=p[2];
+		}
+		return (r>p[0])+(r>p[1])+(r>p[2]);
+	};
 };
 #endif
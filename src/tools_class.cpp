@@ -23,70 +23,276 @@
  */
 
 #include "tools.h"
-#include <conio.h>
+#include "functions.h"
+#ifndef NO_BUILTIN_TABLES
+#include "builtin_tables.h"
+#endif
 #include <math.h>
 #include <stdio.h>
-//Constructs and zeros the probability arrays
+#include <string.h>
+
+#define TABLE_VERSION 3 //change when the contents or layout of the table cache change
+//Header of the binary table cache, padded to 64 bytes so the scatter_bin records that follow stay cache line aligned
+struct table_header {
+	char magic[8];
+	int version;
+	int points;
+	uint64_t key;
+	double rtotal;
+	double rtotal2;
+	char pad[24];
+};
+
+//Constructs with no tables, scattering_probability() calculates or loads them
 tools::tools(SMC *input) : constants(input){
-	int i,j;
-	for (i=0; i<PB_DIM1_SZ; i++)
-		for(j=0; j<PB_DIM2_SZ; j++)
-		{
-			pb[i][j]=0;
-			pb2[i][j]=0;
-		}
+	bins=NULL;
+	fbins=NULL;
+	single=0;
+	pb_size=0;
+	spacing=1;
+	table=NULL;
+	cache.data=NULL;
+	cache.size=0;
+	band_table=NULL;
+	nbands=0;
+	band_points=0;
+};
+tools::~tools(){
+	delete[] table;
+	delete[] band_table;
+	unmap_file(&cache);
 };
 //Calculates the Scattering Probabilities
-int tools::scattering_probability(){ //calculates the scattering probabilities contained in pb[][] and pb2[][]
-	FILE *fp_rate, *fp_pb;
-	bool ratefail=false;
-	bool pbfail=false;
-	int j,inputkey=0,GoAhead=1;
-	e_rate();
-	h_rate();
-	int x = constants->Get_NUMPOINTS();
-	rtotal=pb[0][x]+pb[1][x]+pb[2][x]; //rtotal is the total interaction rate for electrons at the Max energy declaired in class SMC
-	rtotal2=pb2[0][x]+pb2[1][x]+pb2[2][x]; //rtotal 2 is similar for holes
+//The built-in materials use the tables generated by table_gen.cpp when smc was built.
+//Other parameter sets are read from the binary table cache if a previous run made them with the same parameters,
+//otherwise they are calculated and added to the cache. Set table_cache 0 in smc_options.txt to always calculate.
+//The text dumps scattering_rates.txt and scattering_pb.txt are only written with scattering_output 1.
+//The free flight rate bands are set up from the tables by make_bands().
+//table_spacing and table_float in smc_options.txt set the energy grid and the precision of the tables.
+int tools::scattering_probability(){ //calculates the scattering probabilities contained in bins[]
+	int GoAhead=1;
+	grid(read_option("table_spacing",1),read_option("table_float",0)!=0);
+	int usecache=(read_option("table_cache",1)!=0);
+	int text=(read_option("scattering_output",0)!=0);
+	uint64_t key=table_key();
+	char filename[300];
+	cache_filename("scattering",key,filename,sizeof(filename));
+	int loaded=(!text && load_builtin(key));
+	if(!loaded && usecache && !text) loaded=load_tables(filename,key);
+	if(!loaded) {
+		double *rate=new double[2*PB_DIM1_SZ*pb_size];
+		calculate(rate);
+		if(text) GoAhead=write_text(rate,rate+PB_DIM1_SZ*pb_size);
+		delete[] rate;
+		if(usecache) write_tables(filename,key);
+	}
+	make_bands();
+	return(GoAhead);
+	//returns 1 if everything ok
+	//returns 2 if the text output was requested but could not be written
+};
+
+//Always calculates the tables, used by table_gen.cpp to generate the built-in tables. Returns the energy points per mechanism.
+int tools::calculate_tables(){
+	grid(1,0);
+	double *rate=new double[2*PB_DIM1_SZ*pb_size];
+	calculate(rate);
+	delete[] rate;
+	return pb_size;
+};
+
+//Calculates the rates into rate (electrons then holes) and the probabilities into table
+void tools::calculate(double *rate){
+	int j;
+	double *rate2=rate+PB_DIM1_SZ*pb_size;
+	e_rate(rate);
+	h_rate(rate2);
+	int x = pb_size-1;
+	rtotal=rate[x]+rate[pb_size+x]+rate[2*pb_size+x]; //rtotal is the total interaction rate for electrons at the Max energy declaired in class SMC
+	rtotal2=rate2[x]+rate2[pb_size+x]+rate2[2*pb_size+x]; //rtotal 2 is similar for holes
+
+	/****CHANGES THE RATES INTO PROBABILITIES****/
+	size_t record=single ? sizeof(scatter_bin_f) : sizeof(scatter_bin);
+	delete[] table;
+	table=new double[(pb_size*record)/sizeof(double)+2*PB_RECORD];
+	char *aligned=(char *)(((uintptr_t)table+63)&~(uintptr_t)63); //aligned to a cache line
+	scatter_bin *p=(scatter_bin *)aligned;
+	scatter_bin_f *pf=(scatter_bin_f *)aligned;
+	for(j=0; j<pb_size; j++)
+	{
+		scatter_bin bin;
+		bin.pb[0]= rate[j]/rtotal;
+		bin.pb[1]=bin.pb[0]+rate[pb_size+j]/rtotal;
+		bin.pb[2]=bin.pb[1]+rate[2*pb_size+j]/rtotal;
+		bin.pad=0;
+		bin.pb2[0]= rate2[j]/rtotal2;
+		bin.pb2[1]=bin.pb2[0]+rate2[pb_size+j]/rtotal2;
+		bin.pb2[2]=bin.pb2[1]+rate2[2*pb_size+j]/rtotal2;
+		bin.pad2=0;
+		if(single) {
+			int i;
+			for(i=0; i<PB_DIM1_SZ; i++) {
+				pf[j].pb[i]=(float)bin.pb[i];
+				pf[j].pb2[i]=(float)bin.pb2[i];
+			}
+			pf[j].pad=0;
+			pf[j].pad2=0;
+		}
+		else p[j]=bin;
+	}
+	if(single) fbins=pf;
+	else bins=p;
+};
+
+//Sets up the energy grid, points every spacing_meV up to at least the maximum energy of the material.
+//single_precision selects float tables with interpolation. Tables calculated or loaded before are dropped.
+void tools::grid(double spacing_meV, int single_precision){
+	if(spacing_meV<=0) spacing_meV=1;
+	spacing=spacing_meV;
+	single=single_precision;
+	pb_size=(int)ceil(constants->Get_Emax()/(constants->Get_q()*0.001*spacing)-1e-6)+1;
+	Emax=constants->Get_Emax();
+	Escale=(1000.0/spacing)/constants->Get_q();
+	bins=NULL;
+	fbins=NULL;
+};
+
+//Splits the energy range into scattering_bands bands (smc_options.txt, default 32) each with its own free flight rate,
+//the highest total scattering rate up to just above the top of the band. Low energy carriers then fly with a much
+//lower rate than rtotal and waste fewer flights on self-scattering. The last band has no top and uses rtotal.
+//scattering_bands 1 gives the single constant rate rtotal.
+void tools::make_bands(){
+	int b, j, c;
+	nbands=(int)read_option("scattering_bands",32);
+	if(nbands<1) nbands=1;
+	if(nbands>pb_size/2) nbands=pb_size/2; //at least 2 points per band so a carrier stopped at a top is in the next band
+	band_points=(pb_size+nbands-1)/nbands;
+	delete[] band_table;
+	band_table=new flight_band[2*nbands];
+	double hbar=constants->Get_hbar();
+	double mass[2]={constants->Get_e_mass(),constants->Get_h_mass()};
+	double total[2]={rtotal,rtotal2};
+	for(c=0; c<2; c++) {
+		double highest=0;
+		j=0;
+		for(b=0; b<nbands-1; b++) {
+			int top=(b+1)*band_points+1; //highest point reached by rounding an energy below the top of the band
+			if(top>pb_size-1) top=pb_size-1;
+			for(; j<=top; j++) {
+				double p=(c==0) ? Get_pb(2,j) : Get_pb2(2,j);
+				if(p>highest) highest=p;
+			}
+			flight_band *fb=&band_table[c*nbands+b];
+			fb->scale=highest;
+			fb->rate=highest*total[c];
+			fb->k2top=2*mass[c]*(((b+1)*band_points+0.5)/Escale)/(hbar*hbar);
+		}
+		band_table[c*nbands+nbands-1].scale=1;
+		band_table[c*nbands+nbands-1].rate=total[c];
+		band_table[c*nbands+nbands-1].k2top=HUGE_VAL;
+	}
+};
+
+//Points bins at the built-in tables if the parameter set is one of the built-in materials
+int tools::load_builtin(uint64_t key){
+#ifndef NO_BUILTIN_TABLES
+	int i;
+	for(i=0; i<builtin_table_count; i++) {
+		if(!single && builtin_tables[i].key==key && builtin_tables[i].points==pb_size) {
+			rtotal=builtin_tables[i].rtotal;
+			rtotal2=builtin_tables[i].rtotal2;
+			bins=(const scatter_bin *)builtin_tables[i].bins;
+			return 1;
+		}
+	}
+#else
+	(void)key; //table_gen.cpp builds without the built-in tables
+#endif
+	return 0;
+};
+
+//Hash of everything the tables depend on, used to name and check the table cache
+uint64_t tools::table_key(){
+	uint64_t h=CACHE_HASH_START;
+	int version=TABLE_VERSION;
+	h=hash_bytes(&version,sizeof(version),h);
+	h=hash_bytes(&pb_size,sizeof(pb_size),h);
+	h=hash_bytes(&single,sizeof(single),h);
+	h=hash_double(spacing,h);
+	h=hash_double(constants->Get_q(),h);
+	h=hash_double(constants->Get_N(),h); //phonon occupation, covers hw and T
+	h=hash_double(constants->Get_hw(),h);
+	h=hash_double(constants->Get_e_mass(),h);
+	h=hash_double(constants->Get_h_mass(),h);
+	h=hash_double(constants->Get_e_meanpath(),h);
+	h=hash_double(constants->Get_h_meanpath(),h);
+	h=hash_double(constants->Get_e_Eth(),h);
+	h=hash_double(constants->Get_h_Eth(),h);
+	h=hash_double(constants->Get_e_Cii(),h);
+	h=hash_double(constants->Get_h_Cii(),h);
+	h=hash_double(constants->Get_e_gamma(),h);
+	h=hash_double(constants->Get_h_gamma(),h);
+	return h;
+};
+
+//Maps the table cache and points bins into it, returns 0 if it is missing or doesn't match
+int tools::load_tables(const char *filename, uint64_t key){
+	if(!map_file(filename,&cache)) return 0;
+	const table_header *header=(const table_header *)cache.data;
+	size_t record=single ? sizeof(scatter_bin_f) : sizeof(scatter_bin);
+	size_t expected=sizeof(table_header)+(size_t)pb_size*record;
+	if(cache.size!=expected || strcmp(header->magic,"SMCPB")!=0 || header->version!=TABLE_VERSION
+	   || header->points!=pb_size || header->key!=key) {
+		unmap_file(&cache);
+		return 0;
+	}
+	rtotal=header->rtotal;
+	rtotal2=header->rtotal2;
+	const char *records=(const char *)cache.data+sizeof(table_header);
+	if(single) fbins=(const scatter_bin_f *)records;
+	else bins=(const scatter_bin *)records;
+	return 1;
+};
 
+//Adds the tables calculated in this run to the table cache
+void tools::write_tables(const char *filename, uint64_t key){
+	table_header header;
+	memset(&header,0,sizeof(header));
+	strcpy(header.magic,"SMCPB");
+	header.version=TABLE_VERSION;
+	header.points=pb_size;
+	header.key=key;
+	header.rtotal=rtotal;
+	header.rtotal2=rtotal2;
+	const void *records=single ? (const void *)fbins : (const void *)bins;
+	size_t record=single ? sizeof(scatter_bin_f) : sizeof(scatter_bin);
+	if(!write_cache(filename,&header,sizeof(header),records,(size_t)pb_size*record))
+		printf("Could not write scattering table cache \"%s\"\n",filename);
+};
+
+//Writes the rates and probabilities to scattering_rates.txt and scattering_pb.txt
+int tools::write_text(double *rate, double *rate2){
+	FILE *fp_rate, *fp_pb;
+	int j;
 	if ((fp_rate=fopen("scattering_rates.txt","w"))==NULL)
 	{    printf("Cannot oen file \"scattering_rates.txt\"\n");
-		 ratefail=true;}
+		 return(2);}
 	if ((fp_pb=fopen("scattering_pb.txt","w"))==NULL)
 	{    printf("Cannot oen file \"scattering_pb.txt\"\n");
-		 pbfail=true;}
-	if(ratefail||pbfail)
-	{    printf("Output files could not be opened. Would you like to continue (y/n)\n");
-		 do
-		 {inputkey=_getch();}
-		 while(inputkey!='y' && inputkey!='Y' && inputkey!='n' && inputkey!='N');
-		 if (inputkey=='y' || inputkey=='Y')
-			 GoAhead=2;
-		 else GoAhead=0; }
-	/****CHANGES THE RATES INTO PROBABILITIES****/
-	if (GoAhead)
-	{    for(j=0; j<=x; j++)
-		 {
-			 if(!ratefail)
-				 fprintf(fp_rate,"%f, %e, %e, %e, %e, %e, %e\n",j*0.001,pb[0][j],pb[1][j],pb[2][j],pb2[0][j],pb2[1][j],pb2[2][j]);
-			 pb[0][j]= pb[0][j]/rtotal;
-			 pb[1][j]=pb[0][j]+pb[1][j]/rtotal;
-			 pb[2][j]=pb[1][j]+pb[2][j]/rtotal;
-			 pb2[0][j]= pb2[0][j]/rtotal2;
-			 pb2[1][j]=pb2[0][j]+pb2[1][j]/rtotal2;
-			 pb2[2][j]=pb2[1][j]+pb2[2][j]/rtotal2;
-			 if(!pbfail)
-				 fprintf(fp_pb,"j=%d, %e, %e, %e, %e, %e, %e\n",j,pb[0][j],pb[1][j],pb[2][j],pb2[0][j],pb2[1][j],pb2[2][j]);
-		 }}
-	if(!ratefail) fclose(fp_rate);
-	if(!pbfail) fclose(fp_pb);
-	return(GoAhead);
-	// returns 0 for no output and user wants to quit
-	//returns 1 if everything ok
-	//returns 2 if no output but user wants to continue
+		 fclose(fp_rate);
+		 return(2);}
+	for(j=0; j<pb_size; j++)
+	{
+		fprintf(fp_rate,"%f, %e, %e, %e, %e, %e, %e\n",j*0.001*spacing,rate[j],rate[pb_size+j],rate[2*pb_size+j],rate2[j],rate2[pb_size+j],rate2[2*pb_size+j]);
+		fprintf(fp_pb,"j=%d, %e, %e, %e, %e, %e, %e\n",j,Get_pb(0,j),Get_pb(1,j),Get_pb(2,j),Get_pb2(0,j),Get_pb2(1,j),Get_pb2(2,j));
+	}
+	fclose(fp_rate);
+	fclose(fp_pb);
+	return(1);
 };
 
 //calculates the electron scattering rates
-void tools::e_rate(){
+void tools::e_rate(double *rate){
 	int i;
 	double n;
 	double Egap;
@@ -94,26 +300,24 @@ void tools::e_rate(){
 	double e_para, e_para2;
 	e_para=constants->Get_N()/(constants->Get_e_meanpath()*(2*constants->Get_N()+1));
 	e_para2=(constants->Get_N()+1)/(constants->Get_e_meanpath()*(2*constants->Get_N()+1));
-	int j = constants->Get_NUMPOINTS();
-
-	for (i=0; i<=j; i++)
-	{    n=i*constants->Get_q()*0.001;
+	for (i=0; i<pb_size; i++)
+	{    n=i*constants->Get_q()*0.001*spacing;
 		 Egap=(n-constants->Get_e_Eth())/(constants->Get_e_Eth());
-		 pb[0][i]=e_para*sqrt((2*(n+constants->Get_hw()))/constants->Get_e_mass());//rate of phonon absorption
+		 rate[i]=e_para*sqrt((2*(n+constants->Get_hw()))/constants->Get_e_mass());//rate of phonon absorption
 
 		 if (n>constants->Get_hw())
-			 pb[1][i]=e_para2*sqrt((2*(n-constants->Get_hw()))/constants->Get_e_mass()); //rate of phonon emission
-		 else pb[1][i]=0;
+			 rate[pb_size+i]=e_para2*sqrt((2*(n-constants->Get_hw()))/constants->Get_e_mass()); //rate of phonon emission
+		 else rate[pb_size+i]=0;
 
 		 if (Egap>0)
 		 { x=my_pow(Egap,constants->Get_e_gamma());
 		   x1=constants->Get_e_Cii();
-		   pb[2][i]=x*constants->Get_e_Cii();         //rate of impact ionization
+		   rate[2*pb_size+i]=x*constants->Get_e_Cii();         //rate of impact ionization
 		 }
-		 else pb[2][i]=0; }
+		 else rate[2*pb_size+i]=0; }
 };
 //calculates the hole scattering rates
-void tools::h_rate(){
+void tools::h_rate(double *rate){
 	int i;
 	double n;
 	double Egap;
@@ -121,31 +325,39 @@ void tools::h_rate(){
 	double x2,x1;
 	h_para=constants->Get_N()/(constants->Get_h_meanpath()*(2*constants->Get_N()+1));
 	h_para2=(constants->Get_N()+1)/(constants->Get_h_meanpath()*(2*constants->Get_N()+1));
-	int x=constants->Get_NUMPOINTS();
-	for (i=0; i<=x; i++)
-	{    n=i*constants->Get_q()*0.001;
+	for (i=0; i<pb_size; i++)
+	{    n=i*constants->Get_q()*0.001*spacing;
 		 Egap=(n-constants->Get_h_Eth())/(constants->Get_h_Eth());
-		 pb2[0][i]=h_para*sqrt((2*(n+constants->Get_hw()))/constants->Get_h_mass());//rate of phonon absorption
+		 rate[i]=h_para*sqrt((2*(n+constants->Get_hw()))/constants->Get_h_mass());//rate of phonon absorption
 
 		 if (n>constants->Get_hw())
-			 pb2[1][i]=h_para2*sqrt((2*(n-constants->Get_hw()))/constants->Get_h_mass()); //rate of phonon emission
-		 else pb2[1][i]=0;
+			 rate[pb_size+i]=h_para2*sqrt((2*(n-constants->Get_hw()))/constants->Get_h_mass()); //rate of phonon emission
+		 else rate[pb_size+i]=0;
 
 		 if (Egap>0)
 		 { x2=my_pow(Egap,constants->Get_h_gamma());
 		   x1=constants->Get_h_Cii();
-		   pb2[2][i]=x1*x2;         //rate of impact ionization
+		   rate[2*pb_size+i]=x1*x2;         //rate of impact ionization
 		 }
-		 else pb2[2][i]=0; }
+		 else rate[2*pb_size+i]=0; }
 };
 
+//Get the hash of the parameters the tables depend on
+uint64_t tools::Get_key(){
+	return table_key();
+};
 //Get scattering rate of electrons total
 double tools::Get_rtotal(){
 	return rtotal;
 };
+//Get the number of free flight rate bands
+int tools::Get_nbands(){
+	return nbands;
+};
 //Pb get function electrons
 double tools::Get_pb(int i, int j){
-	return pb[i][j];
+	if(single) return fbins[j].pb[i];
+	return bins[j].pb[i];
 };
 //Get scattering rate of holes total
 double tools::Get_rtotal2(){
@@ -153,7 +365,8 @@ double tools::Get_rtotal2(){
 };
 //Pb get function holes
 double tools::Get_pb2(int i, int j){
-	return pb2[i][j];
+	if(single) return fbins[j].pb2[i];
+	return bins[j].pb2[i];
 };
 /*my_pow is used to fix a bug with the pow function in my compiler. My compiler TDM-GCC 4.9.2 has an over
    accuracy problem with the pow function, if the value is not stored straight away it might return a
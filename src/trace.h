@@ -0,0 +1,40 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   trace.h contains the class definition of the trace class for the SMC
+   A trace holds a current against time bin, it only takes memory for the bins that carry current.
+
+   trace_class.cpp contains the class implimentation
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_PAGE 1024 //time bins per page
+
+class trace {
+private:
+	double **page; //pages of TRACE_PAGE bins, allocated when a bin in them is first given a current, NULL read as 0
+	int pages;
+	int bins;
+public:
+	trace(int size);
+	~trace();
+	void add(int bin, double current);
+	void fold(const trace *from); //adds from, which must have as many bins
+	double Get(int bin) const;
+	int Get_bins() const;
+};
+#endif
@@ -0,0 +1,68 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   trace_class.cpp contains the class implimentation of the trace class for the SMC.
+
+   trace.h contains the class definition
+ */
+
+#include "trace.h"
+#include <stddef.h>
+
+//Constructor, a trace of size bins with no pages allocated
+//PUBLIC
+trace::trace(int size){
+	bins=size;
+	pages=(size+TRACE_PAGE-1)/TRACE_PAGE;
+	page=new double*[pages];
+	int p;
+	for(p=0; p<pages; p++) page[p]=NULL;
+};
+trace::~trace(){
+	int p;
+	for(p=0; p<pages; p++) delete[] page[p];
+	delete[] page;
+};
+
+//add adds current to bin, allocating its page the first time
+//PUBLIC
+void trace::add(int bin, double current){
+	int p=bin/TRACE_PAGE;
+	if(page[p]==NULL) {
+		page[p]=new double[TRACE_PAGE];
+		int i;
+		for(i=0; i<TRACE_PAGE; i++) page[p][i]=0;
+	}
+	page[p][bin%TRACE_PAGE]+=current;
+};
+
+//fold adds the pages of from to this trace
+//PUBLIC
+void trace::fold(const trace *from){
+	int p,i;
+	for(p=0; p<pages; p++) {
+		if(from->page[p]==NULL) continue;
+		for(i=0; i<TRACE_PAGE && p*TRACE_PAGE+i<bins; i++) add(p*TRACE_PAGE+i,from->page[p][i]);
+	}
+};
+
+double trace::Get(int bin) const{
+	if(page[bin/TRACE_PAGE]==NULL) return 0;
+	return page[bin/TRACE_PAGE][bin%TRACE_PAGE];
+};
+int trace::Get_bins() const{
+	return bins;
+};
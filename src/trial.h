@@ -0,0 +1,117 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   trial.h contains the class definition of the trial class for the SMC
+   The trial class runs the trials of the device properties mode. Each one owns its carriers, random number
+   generator and current, so one per thread lets trials run side by side.
+
+   trial_class.cpp contains the class implimentation
+ */
+#ifndef TRIAL_H
+#define TRIAL_H
+#include "SMC.h"
+#include "device.h"
+#include "tools.h"
+#include "carrier.h"
+#include "rng.h"
+#include "calendar.h"
+#include "trace.h"
+
+//Outcome of one trial
+struct trial_result {
+	double tn;   //carriers in the trial, the gain
+	double nph;  //phonon scattering events
+	double nii;  //impact ionization events
+	double nsse; //electron self-scattering events
+	double nssh; //hole self-scattering events
+	int highest; //highest electron number used
+	int cutoff;  //1 if a carrier reached the simulation time limit
+	int breakdown_bin; //first time bin with the breakdown current, -1 if the trial didn't break down
+	double area; //charge collected in units of q, from the current by the trapezium rule
+};
+
+//Work of one chunk of a pass, or of the whole trial for the serial passes
+struct sweep_chunk {
+	int immediate;  //1 if current and new pairs go straight into the trial rather than being recorded
+	double nph, nii, nsse, nssh, tn;
+	int cutoff;
+	int deposits, deposit_size;
+	int *bins;      //first and last time bin of each current deposit
+	double *current; //current added to each bin of a deposit
+	int pairs, pair_size;
+	double *pair;   //position, energy, time and weight of each new electron hole pair
+};
+
+class trial {
+private:
+	SMC *constants;
+	device *diode;
+	tools *simulation;
+	carrier *electron;
+	carrier *hole;
+	rng random;
+	int usDevice;     //1 pure electron injection, 2 pure hole injection
+	int population;   //population_limit, 0 tracks every carrier
+	int bias;         //bias index, selects the random number streams
+	double timestep;
+	int CurrentArray;
+	double cutofftime;
+	double BreakdownCurrent;
+	double carrierlimit; //carriers in a trial before the current is checked for breakdown
+	int parallel;     //carriers due in one pass before they are stepped in parallel chunks, 0 never
+	int num;          //trial being run
+	int num_electron, num_hole; //highest carrier numbers used
+	double *Inum;     //current of the bins from flushed on, bin i in entry i%ring_size, its differences between bins until summed
+	int *opened;      //differences of the number of deposits covering each bin, until summed
+	int ring_size;    //a power of 2
+	int flushed;      //bins before this are finished and have gone to sink
+	int last_bin;     //last bin deposited into, -1 if none
+	double flow;      //current at flushed while the differences are not summed
+	int open;         //deposits covering flushed while the differences are not summed
+	double charge;    //sum of the current over the bins, added up as it is deposited
+	double first_current, last_current; //current of the first and last bins, for the trapezium rule
+	int summed;       //1 once Inum holds the current itself
+	int crossing;     //earliest time bin that could be above BreakdownCurrent, no bin before it is, -1 if none is
+	trace *sink;      //takes the finished bins of the trial
+	trace *copy;      //also takes them if not NULL
+	sweep_chunk total; //counts of the trial, the serial sweeps add to it directly
+	sweep_chunk *chunk;
+	int chunk_size;
+	calendar queue;   //carriers waiting for a later window, by 2*carrier number+type (0 electron, 1 hole)
+	int window;       //carriers starting a flight before this time bin are due
+	int *due;         //carriers moved in this pass
+	int ndue, due_size;
+	int *later;       //carriers still due after their flight, moved in the next pass
+	int nlater, later_size;
+	char *left;       //1 for the due carriers that left the diode in a parallel pass
+	int left_size;
+	int step(int type, int pair, rng *r, sweep_chunk *out);
+	void place(int type, int pair, double time);
+	void schedule();
+	void deposit(int first, int last, double current, sweep_chunk *out);
+	int breakdown();
+	void sum();
+	void reach(int bin);
+	void flush(int to);
+	void generate(double z_pos, double Energy, double time, double weight, sweep_chunk *out);
+	void parallel_pass(int pass);
+public:
+	trial(SMC *con, tools *sim, int injection, int population_limit, int parallel_carriers);
+	~trial();
+	void setup(device *dev, int bias_index, double step, int steps, double breakdown_current);
+	void run(int trial_num, trial_result *result, trace *current, trace *current_copy);
+};
+#endif
@@ -0,0 +1,629 @@
+/* Copyright 2017 Advanced Detector Centre, Department of Electronic and
+   Electrical Engineering, University of Sheffield, UK.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.*/
+
+/*
+   trial_class.cpp contains the class implimentation of the trial class for the SMC.
+
+   run() tracks the carriers of one trial through the diode, the carrier loop of device_properties().
+
+   trial.h contains the class definition
+ */
+
+#include "trial.h"
+#include "functions.h"
+#include <math.h>
+#include <stddef.h>
+
+#define TRIAL_SEED 835800 //seed of the random number generators of every trial
+#define SWEEP_CHUNK 256   //carriers in each chunk of a parallel pass
+#define SWEEP_CHUNKS 32767 //most chunks in a pass, set by the chunk streams of rng
+#define TRIAL_RING 1024   //time bins in the current ring to start with
+
+//Copies an array into a new one of size entries
+template <typename T> static T *resize(T *old, int oldsize, int size){
+	T *array=new T[size];
+	int i;
+	for(i=0; i<oldsize; i++) array[i]=old[i];
+	delete[] old;
+	return array;
+};
+//Empties a sweep_chunk, keeping its arrays
+static void clear(sweep_chunk *c, int immediate){
+	c->immediate=immediate;
+	c->nph=0;
+	c->nii=0;
+	c->nsse=0;
+	c->nssh=0;
+	c->tn=0;
+	c->cutoff=0;
+	c->deposits=0;
+	c->pairs=0;
+};
+static void release(sweep_chunk *c){
+	delete[] c->bins;
+	delete[] c->current;
+	delete[] c->pair;
+};
+
+//Constructor, creates the carriers used by every trial run on this object
+//injection is 1 for pure electron and 2 for pure hole injection, parallel_carriers is the number of carriers
+//due in one pass before they are stepped in parallel chunks, 0 never
+//PUBLIC
+trial::trial(SMC *con, tools *sim, int injection, int population_limit, int parallel_carriers) : constants(con), simulation(sim), random(TRIAL_SEED){
+	diode=NULL;
+	electron=new carrier(con);
+	hole=new carrier(con);
+	usDevice=injection;
+	population=population_limit;
+	parallel=parallel_carriers;
+	bias=0;
+	timestep=0;
+	CurrentArray=0;
+	cutofftime=0;
+	BreakdownCurrent=0;
+	carrierlimit=0;
+	num=0;
+	num_electron=0;
+	num_hole=0;
+	ring_size=TRIAL_RING;
+	Inum=new double[ring_size];
+	opened=new int[ring_size];
+	int i;
+	for(i=0; i<ring_size; i++) {
+		Inum[i]=0;
+		opened[i]=0;
+	}
+	flushed=0;
+	last_bin=-1;
+	flow=0;
+	open=0;
+	charge=0;
+	first_current=0;
+	last_current=0;
+	summed=0;
+	crossing=-1;
+	sink=NULL;
+	copy=NULL;
+	total.bins=NULL;
+	total.current=NULL;
+	total.pair=NULL;
+	total.deposit_size=0;
+	total.pair_size=0;
+	clear(&total,1);
+	chunk=NULL;
+	chunk_size=0;
+	window=0;
+	due=NULL;
+	ndue=0;
+	due_size=0;
+	later=NULL;
+	nlater=0;
+	later_size=0;
+	left=NULL;
+	left_size=0;
+};
+trial::~trial(){
+	int c;
+	for(c=0; c<chunk_size; c++) release(&chunk[c]);
+	delete[] chunk;
+	delete[] due;
+	delete[] later;
+	delete[] left;
+	delete[] opened;
+	delete[] Inum;
+	delete electron;
+	delete hole;
+};
+
+//setup sets the field profile, bias index and time bins for the following trials
+//PUBLIC
+void trial::setup(device *dev, int bias_index, double step, int steps, double breakdown_current){
+	diode=dev;
+	bias=bias_index;
+	timestep=step;
+	CurrentArray=steps;
+	cutofftime=(CurrentArray-5)*timestep; // prevents overflow
+	BreakdownCurrent=breakdown_current;
+	//carrierlimit is a threshold to end the simulation early  - RAMO's theorm
+	carrierlimit=BreakdownCurrent*diode->Get_width()/(5*constants->Get_q()*1e5);
+};
+
+//deposit adds current to time bins first to last, straight into the trial's current or recorded in out.
+//Until the current is summed only the ends of the deposit are written, bin first of Inum and opened goes up and
+//bin last+1 down, two writes however many bins a flight covers. Afterwards a bin taken above BreakdownCurrent before crossing becomes the new crossing.
+//PRIVATE
+void trial::deposit(int first, int last, double current, sweep_chunk *out){
+	if(out->immediate) {
+		if(last>CurrentArray-1) last=CurrentArray-1; //a flight past cutofftime can end beyond the array
+		if(first<flushed) first=flushed; //a carrier's deposits start at or after the bin of its flight, so this can't happen
+		if(first>last) return;
+		//Uses Ramos Theorem Here
+		if(last>last_bin) last_bin=last;
+		charge+=current*(last-first+1);
+		reach(last+1);
+		int mask=ring_size-1;
+		if(!summed) {
+			Inum[first&mask]+=current;
+			Inum[(last+1)&mask]-=current;
+			opened[first&mask]++;
+			opened[(last+1)&mask]--;
+			return;
+		}
+		int test;
+		for(test=first; test<=last; test++) {
+			Inum[test&mask]+=current;
+			if(Inum[test&mask]>BreakdownCurrent && (crossing<0 || test<crossing)) crossing=test;
+		}
+		return;
+	}
+	if(out->deposits==out->deposit_size) {
+		int size=2*out->deposit_size+64;
+		out->bins=resize(out->bins,2*out->deposit_size,2*size);
+		out->current=resize(out->current,out->deposit_size,size);
+		out->deposit_size=size;
+	}
+	out->bins[2*out->deposits]=first;
+	out->bins[2*out->deposits+1]=last;
+	out->current[out->deposits]=current;
+	out->deposits++;
+};
+
+//generate starts an electron hole pair from an impact ionization, straight away or recorded in out
+//PRIVATE
+void trial::generate(double z_pos, double Energy, double time, double weight, sweep_chunk *out){
+	if(out->immediate) {
+		num_electron++;
+		electron->generation(num_electron,z_pos,Energy,time,0,(int)floor(time/timestep),weight);
+		num_hole++;
+		hole->generation(num_hole,z_pos,Energy,time,0,(int)floor(time/timestep),weight);
+		out->tn+=weight;
+		electron->activate(num_electron);
+		hole->activate(num_hole);
+		place(0,num_electron,time);
+		place(1,num_hole,time);
+		return;
+	}
+	if(out->pairs==out->pair_size) {
+		int size=2*out->pair_size+64;
+		out->pair=resize(out->pair,4*out->pair_size,4*size);
+		out->pair_size=size;
+	}
+	double *p=out->pair+4*out->pairs;
+	p[0]=z_pos;
+	p[1]=Energy;
+	p[2]=time;
+	p[3]=weight;
+	out->pairs++;
+};
+
+//reach grows the ring so it holds the bins from flushed to bin
+//PRIVATE
+void trial::reach(int bin){
+	if(bin-flushed<ring_size) return;
+	int size=ring_size;
+	while(bin-flushed>=size) size*=2;
+	double *current=new double[size];
+	int *count=new int[size];
+	int i;
+	for(i=0; i<size; i++) {
+		current[i]=0;
+		count[i]=0;
+	}
+	for(i=flushed; i<flushed+ring_size; i++) {
+		current[i&(size-1)]=Inum[i&(ring_size-1)];
+		count[i&(size-1)]=opened[i&(ring_size-1)];
+	}
+	delete[] Inum;
+	delete[] opened;
+	Inum=current;
+	opened=count;
+	ring_size=size;
+};
+
+//flush finishes the bins from flushed to before bin to, sums them if need be, hands them to sink and clears
+//them from the ring. Bins past the last deposit hold no current and are skipped. As no carrier deposits before
+//window-2 the ring only spans the carriers of the trial in time, not the simulation time.
+//PRIVATE
+void trial::flush(int to){
+	if(to>CurrentArray+1) to=CurrentArray+1;
+	int end=(to<last_bin+2) ? to : last_bin+2;
+	int mask=ring_size-1;
+	int b,i;
+	for(b=flushed; b<end; b++) {
+		double current;
+		if(summed) current=Inum[b&mask];
+		else {
+			flow+=Inum[b&mask];
+			open+=opened[b&mask];
+			opened[b&mask]=0;
+			if(open==0) flow=0;
+			current=flow;
+		}
+		Inum[b&mask]=0;
+		if(b==0) first_current=current;
+		if(b==CurrentArray-1) last_current=current;
+		if(current!=0 && b<CurrentArray) {
+			sink->add(b,current);
+			if(copy!=NULL && b<CurrentArray-1) copy->add(b,current);
+		}
+		if(!summed) {
+			if(crossing<0 && current>BreakdownCurrent) crossing=b;
+		}
+		else if(b==crossing && !(current>BreakdownCurrent)) {
+			//a negative deposit brought crossing back down, the next bin above is still in the ring
+			for(i=b+1; i<=last_bin; i++) {
+				if(Inum[i&mask]>BreakdownCurrent) break;
+			}
+			crossing=(i<=last_bin) ? i : -1;
+		}
+	}
+	if(to>flushed) flushed=to;
+};
+
+//sum turns the differences in the ring into the current of each bin, carrying on from the bins already flushed,
+//and finds crossing if no flushed bin was above BreakdownCurrent. A bin no deposit covers is set to exactly 0
+//rather than left with the rounding of the sum. Called once the trial has enough carriers to break down.
+//PRIVATE
+void trial::sum(){
+	int mask=ring_size-1;
+	int b;
+	summed=1;
+	for(b=flushed; b<=last_bin; b++) {
+		flow+=Inum[b&mask];
+		open+=opened[b&mask];
+		opened[b&mask]=0;
+		if(open==0) flow=0;
+		Inum[b&mask]=flow;
+		if(crossing<0 && flow>BreakdownCurrent) crossing=b;
+	}
+	if(last_bin+1>=flushed) {
+		Inum[(last_bin+1)&mask]=0;
+		opened[(last_bin+1)&mask]=0;
+	}
+};
+
+//breakdown returns the first time bin with a current above BreakdownCurrent, -1 if there is none.
+//Usually that is crossing, the bins in the ring after it are only searched if a negative deposit has brought it
+//back down. A flushed crossing is final.
+//PRIVATE
+int trial::breakdown(){
+	int mask=ring_size-1;
+	if(crossing<flushed || Inum[crossing&mask]>BreakdownCurrent) return crossing;
+	int i;
+	for(i=crossing+1; i<=last_bin; i++) {
+		if(Inum[i&mask]>BreakdownCurrent) break;
+	}
+	crossing=(i<=last_bin) ? i : -1;
+	return crossing;
+};
+
+//step moves carrier pair, an electron for type 0 and a hole for type 1, through its next flight. Shared by the
+//serial passes and the chunks of parallel_pass().
+//Only the carrier's own entries are written, the current and new pairs go through deposit() and generate().
+//Returns 1 if the carrier left the diode.
+//PRIVATE
+int trial::step(int type, int pair, rng *r, sweep_chunk *out){
+	carrier *c=(type==0) ? electron : hole;
+	double sign=(type==0) ? 1 : -1; //electrons are accelerated against the field direction, holes with it
+	double mass=(type==0) ? constants->Get_e_mass() : constants->Get_h_mass();
+	double q=constants->Get_q();
+	double hbar=constants->Get_hbar();
+	double z_pos=c->Get_pos(pair);
+	double time=c->Get_time(pair);
+	double dt=c->Get_dt(pair);
+	double dx=c->Get_dx(pair);
+	double weight=c->Get_weight(pair); //real carriers represented by the carrier being moved
+	if(type==0 && z_pos<diode->Get_xmin()) z_pos=diode->Get_xmin()+1e-10; // resets a bad trial where the electron drifted out the device the wrong way (extremly rare but causes program to hang)
+	if(type==1 && z_pos>diode->Get_xmax()) z_pos=diode->Get_xmax()-1e-10;
+	double Energy=c->Get_Egy(pair);
+	if((c->Get_scattering(pair)==0))//if not selfscattering scatters in random direction
+	{   c->scatter(pair,2*type,r);}
+
+	double kxy=c->Get_kxy(pair);
+	double kz=c->Get_kz(pair);
+
+	//drift process starts
+	//drifts for a random time at the free flight rate of the carrier's energy band
+	int band=simulation->band(Energy);
+	double drift_t=r->exprand()/simulation->Get_rate(type,band); //exponentially distributed free flight time
+	double Efield=diode->Efield_at_x(z_pos);
+	int crossed=simulation->band_exit(type,band,kxy,kz,sign*((q*Efield)/hbar),&drift_t);
+	time+=drift_t;
+	dt+=drift_t;
+
+	//updates parameters based on random drift time
+	kz+=sign*((q*drift_t*Efield)/hbar);
+	double dE=((hbar*hbar)/(2*mass))*(kxy+kz*kz)-Energy;
+	Energy=((hbar*hbar)/(2*mass))*(kxy+kz*kz);
+	z_pos+=sign*(dE/(q*Efield));
+	dx+=dE/(q*Efield);
+	if(time>cutofftime) {
+		//cuts off the carrier and removes it from device if user spec. timelimit exceeded
+		z_pos=(type==0) ? diode->Get_xmax()+10 : diode->Get_xmin()-10;
+		out->cutoff=1;
+	}
+	if(dt>=timestep) {
+		//calc current  if time since last calculated  >timestep
+		int timearray=(int)floor(time/timestep);
+		deposit(c->Get_timearray(pair)+1,timearray,weight*q*dx/(dt*diode->Get_width()),out);
+		c->Input_timearray(pair,timearray);
+		dt=0;
+		dx=0;
+	}
+	c->Input_time(pair,time);
+	c->Input_dt(pair,dt);
+	c->Input_dx(pair,dx);
+	//drift process ends
+
+	//update position and energy
+	c->Input_pos(pair,z_pos);
+	c->Input_Egy(pair,Energy);
+
+	if(type==0) {
+		if(z_pos<0) z_pos=1e-10;
+		if(!(z_pos<=diode->Get_xmax())) return 1;
+	}
+	else {
+		if(z_pos>diode->Get_xmax()) z_pos=diode->Get_xmax()-1e-10;
+		if(!(z_pos>=diode->Get_xmin())) return 1;
+	}
+	//scattering process starts
+	switch(crossed ? SCAT_SELF : simulation->select(type,Energy,band,r))
+	{
+	case SCAT_ABSORPTION: //phonon absorption
+		Energy+=constants->Get_hw();
+		out->nph++;
+		c->Input_scattering(pair,0);
+		break;
+	case SCAT_EMISSION: //phonon emission
+		Energy-=constants->Get_hw();
+		out->nph++;
+		c->Input_scattering(pair,0);
+		break;
+	case SCAT_IONIZATION: //impact ionization
+		Energy=(Energy-((type==0) ? constants->Get_e_Eth() : constants->Get_h_Eth()))/3.0;
+		generate(z_pos,Energy,time,weight,out);
+		out->nii++;
+		c->Input_scattering(pair,0);
+		break;
+	default: //selfscattering
+		if(type==0) out->nsse++;
+		else out->nssh++;
+		c->Input_scattering(pair,1);
+		c->Input_kxy(pair,kxy);
+		c->Input_kz(pair,kz);
+	}
+	//scattering process ends
+	c->Input_Egy(pair,Energy);
+	return 0;
+};
+
+//place files carrier pair of type under the next pass if its next flight starts before the window bin,
+//otherwise in the calendar queue under the time bin it starts in, so a carrier ahead in time is not visited
+//until the window reaches it.
+//Doing this limits the program to only be simulating the carriers in the same timebin at the same time (Important for calculating instentanious current)
+//PRIVATE
+void trial::place(int type, int pair, double time){
+	int id=2*pair+type;
+	int bin=(int)floor(time/timestep);
+	if(bin>=window) {
+		queue.add(id,bin);
+		return;
+	}
+	if(nlater==later_size) {
+		later=resize(later,later_size,2*later_size+64);
+		later_size=2*later_size+64;
+	}
+	later[nlater++]=id;
+};
+
+//schedule files every active carrier again, after population control has changed which carriers are active
+//PRIVATE
+void trial::schedule(){
+	int k;
+	nlater=0;
+	queue.clear(window);
+	for(k=0; k<electron->Get_nactive(); k++) place(0,electron->Get_active(k),electron->Get_time(electron->Get_active(k)));
+	for(k=0; k<hole->Get_nactive(); k++) place(1,hole->Get_active(k),hole->Get_time(hole->Get_active(k)));
+};
+
+//parallel_pass moves the due carriers once, in chunks of SWEEP_CHUNK carriers run as tasks, when parallel_carriers
+//are due so idle threads help with a large avalanche.
+//Each chunk draws from the stream of its pass and chunk number and records its work, which is then added to
+//the trial in chunk order, so the outcome is the same whichever thread runs a chunk.
+//PRIVATE
+void trial::parallel_pass(int pass){
+	int size=SWEEP_CHUNK;
+	while((ndue+size-1)/size>SWEEP_CHUNKS) size*=2;
+	int n=(ndue+size-1)/size;
+	if(n>chunk_size) {
+		sweep_chunk *grown=new sweep_chunk[n];
+		int c;
+		for(c=0; c<n; c++) {
+			if(c<chunk_size) grown[c]=chunk[c];
+			else {
+				grown[c].bins=NULL;
+				grown[c].current=NULL;
+				grown[c].pair=NULL;
+				grown[c].deposit_size=0;
+				grown[c].pair_size=0;
+			}
+		}
+		delete[] chunk;
+		chunk=grown;
+		chunk_size=n;
+	}
+	if(ndue>left_size) {
+		delete[] left;
+		left_size=ndue;
+		left=new char[left_size];
+	}
+	int c;
+	#pragma omp taskloop grainsize(1)
+	for(c=0; c<n; c++) {
+		sweep_chunk *out=&chunk[c];
+		clear(out,0);
+		rng r(TRIAL_SEED);
+		r.chunk_stream(bias,num,pass,c);
+		int first=c*size;
+		int last=first+size;
+		if(last>ndue) last=ndue;
+		int k;
+		for(k=first; k<last; k++) left[k]=(char)step(due[k]&1,due[k]>>1,&r,out);
+	}
+	int k;
+	for(k=0; k<ndue; k++) {
+		int type=due[k]&1;
+		int pair=due[k]>>1;
+		carrier *cr=(type==0) ? electron : hole;
+		if(left[k]) cr->remove(pair);
+		else place(type,pair,cr->Get_time(pair));
+	}
+	for(c=0; c<n; c++) {
+		sweep_chunk *out=&chunk[c];
+		int d,p;
+		for(d=0; d<out->deposits; d++) deposit(out->bins[2*d],out->bins[2*d+1],out->current[d],&total);
+		for(p=0; p<out->pairs; p++) {
+			double *pr=out->pair+4*p;
+			generate(pr[0],pr[1],pr[2],pr[3],&total);
+		}
+		total.nph+=out->nph;
+		total.nii+=out->nii;
+		total.nsse+=out->nsse;
+		total.nssh+=out->nssh;
+		if(out->cutoff) total.cutoff=1;
+	}
+};
+
+//run simulates trial num, the current of the trial is added to current and current_copy, if not NULL, and
+//the counts go into result
+//PUBLIC
+void trial::run(int trial_num, trial_result *result, trace *current, trace *current_copy){
+	num=trial_num;
+	sink=current;
+	copy=current_copy;
+	flushed=0; //the ring is left empty by the last trial
+	last_bin=-1;
+	flow=0;
+	open=0;
+	charge=0;
+	first_current=0;
+	last_current=0;
+	summed=0;
+	crossing=-1;
+	result->highest=0;
+	random.stream(bias,num,0); //each trial has its own random number stream
+	num_electron=1;
+	num_hole=1;
+	clear(&total,1);
+	total.tn=1;
+	int cut2=0;
+	int pass=0;
+	window=1; //the carriers start at time 0, in bin 0
+	nlater=0;
+	queue.clear(window);
+
+
+	/* Device 1-PIN
+	   Device 2-NIP*/
+
+	if (usDevice==1) {
+		electron->Input_pos(1,diode->Get_xmin()+1e-10);
+		hole->Input_pos(1,-1);
+	}
+	if (usDevice==2) {
+		electron->Input_pos(1,(diode->Get_xmax()+1e-10));
+		hole->Input_pos(1,(diode->Get_xmax()-1e-10));
+	}
+	//only the starting carriers inside the diode are tracked
+	electron->Input_weight(1,1);
+	hole->Input_weight(1,1);
+	if(electron->Get_pos(1)<diode->Get_xmax()) electron->activate(1);
+	if(hole->Get_pos(1)>=diode->Get_xmin()) hole->activate(1);
+	schedule();
+
+	/****TRACKS CARRIERS WHILE IN DIODE****/
+	while(cut2==0)
+	{
+		int *swap=due; //the carriers left due by the last pass are moved in this one
+		due=later;
+		later=swap;
+		int swap_size=due_size;
+		due_size=later_size;
+		later_size=swap_size;
+		ndue=nlater;
+		nlater=0;
+		if(ndue==0) {
+			//This is where the window is moved on, straight to the earliest time bin with any carriers
+			if(queue.Get_waiting()==0) break;
+			ndue=queue.take(&due,&due_size);
+			window=queue.Get_bin()+1;
+		}
+		if(parallel>0 && ndue>=parallel) parallel_pass(pass);
+		else {
+			/****MOVES THE DUE ELECTRONS AND HOLES****/
+			int k;
+			for(k=0; k<ndue; k++) {
+				int type=due[k]&1;
+				int pair=due[k]>>1;
+				carrier *cr=(type==0) ? electron : hole;
+				if(step(type,pair,&random,&total)) cr->remove(pair); //the last carrier in the active list takes its place
+				else place(type,pair,cr->Get_time(pair));
+			}
+		}
+		pass++;
+		flush(window-2); //every carrier's next deposit starts at or after the bin before the window
+		result->highest=(int)_max(result->highest,num_electron);
+		//population control, merges the carriers when there are too many and splits them again when the avalanche dies down
+		if(population>0) {
+			int merged=0;
+			int electrons=num_electron;
+			int holes=num_hole;
+			if(electron->Get_nactive()>population) {
+				electron->merge(&random);
+				merged=1;
+			}
+			else if(electron->Get_nactive()<population/4) num_electron=electron->split(population/2,num_electron);
+			if(hole->Get_nactive()>population) {
+				hole->merge(&random);
+				merged=1;
+			}
+			else if(hole->Get_nactive()<population/4) num_hole=hole->split(population/2,num_hole);
+			if(merged || num_electron!=electrons || num_hole!=holes) schedule(); //the queue still holds the carriers that were merged away
+		}
+		//stops the trial early once the current has reached the breakdown current
+		if(total.tn>carrierlimit) {
+			if(!summed) sum(); //from here on the current is deposited bin by bin so crossing stays up to date
+			if(breakdown()>=0) cut2=1;
+		}
+	}
+
+	result->tn=total.tn;
+	result->nph=total.nph;
+	result->nii=total.nii;
+	result->nsse=total.nsse;
+	result->nssh=total.nssh;
+	result->cutoff=total.cutoff;
+	flush(CurrentArray+1);
+	//checks for breakdown at end of sim
+	result->breakdown_bin=breakdown();
+	//trapezium rule, the sum of the bins less half of the first and last
+	double totalareanum=timestep*(charge-0.5*first_current-0.5*last_current);
+	result->area=totalareanum/1.6e-19;
+	//reset carrier arrays to 0 after trial
+	electron->reset();
+	hole->reset();
+};
+